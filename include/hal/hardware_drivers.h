@@ -1,5 +1,6 @@
 #pragma once
 #include "titan/core/types.h"
+#include "titan/core/realtime.h"
 #include <thread>
 #include <atomic>
 #include <iostream>
@@ -54,6 +55,13 @@ private:
     }
 };
 
+// 本体驱动对指令的反馈 (由驱动线程发布)
+struct BodyFeedback {
+    uint64_t command_id = 0;                    // 最近一条被驱动接收的指令
+    ComponentState state = ComponentState::READY;
+    bool reached = false;                       // 该指令已执行到位
+};
+
 // 2. 机械臂/本体驱动 (独立线程，硬实时 1kHz)
 class RobotBodyDriver {
 public:
@@ -70,22 +78,52 @@ public:
 
     ComponentState getState() const { return state_; }
     
-    // 接收控制指令 (非阻塞)
-    void setCommand(const Eigen::VectorXd& torques) {
+    // 接收控制指令 (非阻塞)；command_id 随反馈回传，用于判断哪条指令到位
+    void setCommand(const Eigen::VectorXd& torques, uint64_t command_id = 0) {
         // 写入底层寄存器...
         // 模拟: 如果力矩过大，设置 STALLED 状态
-        if (torques.norm() > 50.0) state_ = ComponentState::STALLED;
+        state_ = torques.norm() > 50.0 ? ComponentState::STALLED : ComponentState::ACTIVE;
+        commanded_id_.store(command_id, std::memory_order_release);
+    }
+
+    // 力前馈与速度上限 (非阻塞，内环每周期写入)
+    void setEffort(double force, double velocity_limit) {
+        // 写入底层寄存器... 模拟: 只记录最新值
+        force_.store(force, std::memory_order_relaxed);
+        velocity_limit_.store(velocity_limit, std::memory_order_relaxed);
     }
+    double commandedForce() const { return force_.load(std::memory_order_relaxed); }
+
+    // 最新反馈 (无锁，可在控制线程每周期调用)
+    BodyFeedback feedback() const { return feedback_.load(); }
 
 private:
     Callback callback_;
     std::thread worker_;
     std::atomic<bool> running_;
     std::atomic<ComponentState> state_{ComponentState::READY};
+    std::atomic<uint64_t> commanded_id_{0};
+    std::atomic<double> force_{0.0};
+    std::atomic<double> velocity_limit_{0.0};
+    SeqLock<BodyFeedback> feedback_;
 
     void loop() {
+        // 绝对截止时间: 回调耗时不会累积成周期漂移
+        PeriodicTimer timer(std::chrono::milliseconds(1));
         while (running_) {
-            state_ = ComponentState::ACTIVE;
+            uint64_t id = commanded_id_.load(std::memory_order_acquire);
+            ComponentState st = state_.load();
+            if (st != ComponentState::STALLED) {
+                state_.compare_exchange_strong(st, ComponentState::ACTIVE);   // 堵转保持到下一条指令
+            }
+
+            // 模拟: 指令在下一个驱动周期到位；堵转的指令永远不会到位
+            BodyFeedback fb;
+            fb.command_id = id;
+            fb.state = st == ComponentState::STALLED ? st : ComponentState::ACTIVE;
+            fb.reached = id != 0 && st != ComponentState::STALLED;
+            feedback_.store(fb);
+
             auto now = std::chrono::steady_clock::now();
 
             RobotState rs;
@@ -95,7 +133,7 @@ private:
             if (callback_) callback_(rs);
 
             // 1ms 周期
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            timer.wait();
         }
     }
 };
@@ -1,53 +1,207 @@
 #pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
 #include <string>
-#include <functional>
-#include <vector>
-#include <iostream>
-#include <variant>
+#include <string_view>
 #include "titan/core/types.h"
+#include "titan/core/async_logger.h"
+#include "titan/core/fixed_string.h"
+#include "titan/core/inline_function.h"
+#include "titan/core/ring_buffer.h"
 
 namespace titan::agent {
 
-// 行为提案
+// 提案来源 ID: 来源名在第一次使用时登记一次，之后每个 tick 只比较整数
+using SourceId = uint16_t;
+constexpr SourceId NO_SOURCE = 0;
+
+class SourceRegistry {
+private:
+    std::mutex mtx_;
+    std::deque<std::string> names_{""};   // deque: 已登记的名字地址稳定，sourceName 可以无锁返回视图
+
+public:
+    static SourceRegistry& instance() {
+        static SourceRegistry reg;
+        return reg;
+    }
+
+    SourceId intern(std::string_view name) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        for (size_t i = 1; i < names_.size(); ++i) {
+            if (names_[i] == name) return static_cast<SourceId>(i);
+        }
+        names_.emplace_back(name);
+        return static_cast<SourceId>(names_.size() - 1);
+    }
+
+    std::string_view name(SourceId id) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return id < names_.size() ? std::string_view(names_[id]) : std::string_view("?");
+    }
+};
+
+// 调用方用函数内 static 缓存结果: static const SourceId SAFETY = internSource("SafetyReflex");
+inline SourceId internSource(std::string_view name) { return SourceRegistry::instance().intern(name); }
+inline std::string_view sourceName(SourceId id) { return SourceRegistry::instance().name(id); }
+
+// 行为提案 (无堆分配: 描述和回调都是内联存储)
 struct ActionProposal {
-    std::string source;      // "Safety", "Task", "Exploration"
-    double priority;         // 0.0 ~ 1.0+
-    std::string description; // "Emergency Stop", "Grasp Bottle"
-    
-    // 具体执行的回调函数
-    std::function<void()> execute; 
+    using Callback = titan::core::InlineFunction<void(), 64>;
+
+    SourceId source = NO_SOURCE;              // "Safety", "Task", "Exploration"
+    double priority = 0.0;                    // 0.0 ~ 1.0+
+    titan::core::FixedString<96> description; // "Emergency Stop", "Grasp Bottle"
+
+    // 具体执行的回调函数 (捕获超过 64 字节时编译报错)
+    Callback execute;
+};
+
+// 定容量提案集合: 由调用方持有并在每个 tick 复用
+class ProposalSet {
+public:
+    static constexpr size_t MAX_PROPOSALS = 16;
+
+private:
+    std::array<ActionProposal, MAX_PROPOSALS> items_;
+    size_t size_ = 0;
+
+public:
+    // 满时丢弃并返回 false
+    bool push(ActionProposal&& p) {
+        if (size_ == MAX_PROPOSALS) return false;
+        items_[size_++] = std::move(p);
+        return true;
+    }
+
+    void clear() {
+        for (size_t i = 0; i < size_; ++i) items_[i].execute = nullptr;   // 释放闭包捕获
+        size_ = 0;
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    ActionProposal& operator[](size_t i) { return items_[i]; }
+    const ActionProposal& operator[](size_t i) const { return items_[i]; }
 };
 
+// 行为仲裁: 赢者通吃 + 切换代价
+//
+// 上一轮赢家 (在位者) 仍在提案时，挑战者必须同时满足:
+//   1. 在位者已经执行了至少 min_dwell (最短驻留时间)
+//   2. 优先级超过在位者 hysteresis + 在位者所属类别的抢占代价
+// 否则继续执行在位者本轮的提案。优先级达到 safety_priority 的提案 (安全反射) 无视以上限制立即接管。
+// 在位者本轮没有可执行的提案 (空闲或不再提案) 时不设门槛。
+// 没有回调的提案 (空闲占位) 不参与竞争: 它既不会赢，也不计入切换次数。
 class BehaviorArbiter {
+public:
+    struct Options {
+        double hysteresis = 0.1;                          // 切换所需的最小优先级优势
+        std::chrono::milliseconds min_dwell{500};         // 切换后至少保持的时间
+        double safety_priority = 50.0;                    // 达到该优先级的提案立即抢占
+        std::chrono::seconds rate_window{10};             // 切换频率的统计窗口
+    };
+
+    struct Stats {
+        uint64_t ticks = 0;
+        uint64_t switches = 0;
+        uint64_t held_by_dwell = 0;      // 因最短驻留时间被压下的切换
+        uint64_t held_by_margin = 0;     // 因滞后 / 抢占代价被压下的切换
+        uint64_t safety_overrides = 0;
+        double switch_rate_hz = 0.0;     // 最近 rate_window 内的切换频率
+    };
+
 private:
-    std::string last_winner_;
-    double hysteresis_ = 0.1; // 滞后阈值，防止频繁切换
+    using Clock = std::chrono::steady_clock;
+    static constexpr size_t MAX_SOURCES = 64;
+    static constexpr size_t RATE_HISTORY = 1024;   // 100 Hz tick 下覆盖 10 s 窗口
+
+    Options opts_;
+    SourceId last_winner_ = NO_SOURCE;
+    Clock::time_point last_switch_{};
+    std::array<double, MAX_SOURCES> preemption_cost_{};   // 按 SourceId 索引
+
+    Stats stats_;
+    titan::core::FixedRing<Clock::time_point> recent_switches_{RATE_HISTORY};
+
+    double preemptionCost(SourceId id) const { return id < MAX_SOURCES ? preemption_cost_[id] : 0.0; }
+
+    void recordSwitch(const ActionProposal& winner, Clock::time_point now, bool safety) {
+        titan::core::AsyncLogger::instance().log(
+            std::string(safety ? "[Arbiter] Safety override: " : "[Arbiter] Switching Behavior: ") +
+            std::string(sourceName(last_winner_)) + " -> " + std::string(sourceName(winner.source)) + " (" +
+            std::to_string(winner.priority) + "): " + std::string(winner.description.view()));
+        last_winner_ = winner.source;
+        last_switch_ = now;
+        ++stats_.switches;
+        if (safety) ++stats_.safety_overrides;
+        recent_switches_.push_back(now);
+    }
 
 public:
+    BehaviorArbiter() : BehaviorArbiter(Options{}) {}
+    explicit BehaviorArbiter(const Options& opts) : opts_(opts) {}
+
+    // 打断该类别的行为需要额外付出的优先级 (例如打断任务执行会让 ActionManager 重新规划动作)
+    void setPreemptionCost(SourceId source, double cost) {
+        if (source < MAX_SOURCES) preemption_cost_[source] = cost;
+    }
+
     // 核心逻辑：赢者通吃 (Winner-Take-All)
-    void arbitrate(std::vector<ActionProposal>& proposals) {
+    // 单次扫描取最高优先级 (同分时先提交者胜，结果确定)；不排序、不分配
+    void arbitrate(ProposalSet& proposals, Clock::time_point now = Clock::now()) {
         if (proposals.empty()) return;
+        ++stats_.ticks;
 
-        // 1. 排序
-        std::sort(proposals.begin(), proposals.end(), [](const auto& a, const auto& b) {
-            return a.priority > b.priority;
-        });
-
-        const auto& winner = proposals[0];
+        // 1. 在可执行的提案中选最大，同时找到在位者本轮的提案
+        const size_t none = proposals.size();
+        size_t best = none;
+        size_t incumbent = none;
+        for (size_t i = 0; i < proposals.size(); ++i) {
+            if (!proposals[i].execute) continue;
+            if (best == none || proposals[i].priority > proposals[best].priority) best = i;
+            if (incumbent == none && proposals[i].source == last_winner_) incumbent = i;
+        }
+        if (best == none) return;   // 本轮全是空闲占位: 保持在位者不变
+        const ActionProposal* winner = &proposals[best];
 
-        // 2. 稳定性检查 (Hysteresis)
-        // 如果新赢家不是上一个赢家，且优先级优势不明显，则保持上一个 (避免抖动)
-        if (winner.source != last_winner_) {
-             // 查找上一轮赢家在本次的排位
-             // (此处简化逻辑，直接执行最高分)
-             std::cout << "[Arbiter] Switching Behavior: " << last_winner_ << " -> " << winner.source << std::endl;
+        // 2. 稳定性检查 (Hysteresis + 驻留时间 + 抢占代价)
+        if (winner->source != last_winner_) {
+            bool safety = winner->priority >= opts_.safety_priority;
+            bool hold = false;
+            if (!safety && incumbent != none) {
+                const ActionProposal& inc = proposals[incumbent];
+                if (now - last_switch_ < opts_.min_dwell) {
+                    ++stats_.held_by_dwell;
+                    hold = true;
+                } else if (winner->priority <= inc.priority + opts_.hysteresis + preemptionCost(inc.source)) {
+                    ++stats_.held_by_margin;
+                    hold = true;
+                }
+            }
+            if (hold) {
+                winner = &proposals[incumbent];
+            } else {
+                recordSwitch(*winner, now, safety);
+            }
         }
 
         // 3. 执行
-        std::cout << "[Exec] [" << winner.source << "] (" << winner.priority << "): " << winner.description << std::endl;
-        winner.execute();
-        
-        last_winner_ = winner.source;
+        winner->execute();
+    }
+
+    // 统计快照 (与 arbitrate 在同一线程调用)
+    Stats stats() {
+        while (!recent_switches_.empty() && recent_switches_.front() + opts_.rate_window < Clock::now()) {
+            recent_switches_.pop_front();
+        }
+        Stats s = stats_;
+        s.switch_rate_hz = static_cast<double>(recent_switches_.size()) /
+                           std::chrono::duration<double>(opts_.rate_window).count();
+        return s;
     }
 };
 
@@ -22,6 +22,7 @@ struct ActiveTask {
     std::string goal;
     titan::agent::TaskStatus status = titan::agent::TaskStatus::PENDING;
     std::string current_step;
+    std::vector<int> applied_strategies;   // 规划时检索并写进 Prompt 的策略 ID (任务结束时回报成败)
     // ... 其他任务元数据
 };
 
@@ -40,6 +41,12 @@ private:
     ActiveTask current_task_;
     std::future<std::string> llm_planning_result_; // 异步 LLM 规划结果
 
+    // 目标解析缓存 (getBestProposal 每个 tick 都要用)
+    std::string parsed_goal_;
+    std::string target_keyword_;
+    bool target_wants_red_ = false;
+    int resolved_track_id_ = -1;
+
     // 状态追踪：用于 needsEnvironmentalUpdate
     TimePoint last_env_update_time_;
     TimePoint last_cognition_plan_time_;
@@ -88,8 +95,9 @@ public:
         }
 
         // 1. RAG 策略检索 (RAG)
-        std::string recent_context = cognitive_stream_->buildContextPrompt();
-        std::string strategies = strategy_optimizer_->retrieveRelevantStrategies(current_task_.goal, recent_context);
+        std::string_view recent_context = cognitive_stream_->contextPrompt();
+        std::string strategies = strategy_optimizer_->retrieveRelevantStrategies(current_task_.goal, recent_context, nullptr,
+                                                                             &current_task_.applied_strategies);
         
         // 2. 构建完整 Prompt
         std::string planning_prompt;
@@ -151,6 +159,7 @@ public:
         if (current_task_.status == TaskStatus::PENDING) {
             // 如果有新指令，但没有规划，立即触发第一次规划
             if (!current_task_.goal.empty()) {
+                if (cognitive_stream_) cognitive_stream_->beginEpisode();
                 triggerPlanning("Initial planning for new goal: " + current_task_.goal);
                 current_task_.status = TaskStatus::ACTIVE;
             }
@@ -255,14 +264,15 @@ public:
             
             // A. 空间狭窄检测 (Safety / Navigation)
             if (metrics.clearance_ratio < 1.5 && metrics.clearance_ratio > 0.1) { // >0.1 防止除零误报
-                proposal.source = "EnvironmentalAwareness";
-                proposal.description = "Narrow passage (" + std::to_string(metrics.estimated_width) + "m). Slowing down.";
+                static const SourceId ENV_AWARENESS = internSource("EnvironmentalAwareness");
+                proposal.source = ENV_AWARENESS;
+                proposal.description.format("Narrow passage (%fm). Slowing down.", metrics.estimated_width);
                 proposal.priority = 8.0; // 高优先级，为了安全
                 
                 proposal.execute = [this]() {
                     if (action_mgr_) {
                         // 切换到爬行/低速模式
-                        action_mgr_->execute(Eigen::VectorXd::Zero(6), "SetMode:CRAWL");
+                        action_mgr_->setMode(titan::control::ActionManager::BodyMode::CRAWL);
                     }
                     if (cognitive_stream_) {
                         cognitive_stream_->addEvent(EventType::PERCEPTION_BODY, "Environment is tight. Speed reduced.");
@@ -273,8 +283,9 @@ public:
             
             // B. 电量焦虑 (Self-Preservation)
             if (metrics.battery_level < 0.2 && metrics.battery_level > 0.0) {
-                proposal.source = "SelfPreservation";
-                proposal.description = "Low Battery (" + std::to_string((int)(metrics.battery_level*100)) + "%). Seeking charger.";
+                static const SourceId SELF_PRESERVATION = internSource("SelfPreservation");
+                proposal.source = SELF_PRESERVATION;
+                proposal.description.format("Low Battery (%d%%). Seeking charger.", (int)(metrics.battery_level*100));
                 proposal.priority = 20.0; // 极高优先级
                 
                 proposal.execute = [this]() {
@@ -302,72 +313,47 @@ public:
         // 3. 默认认知探索 (Idle Behavior)
         // 如果没有特别紧急的环境事件，且世界模型为空，则主动观察
         if (cognition.getAllEntitiesPtrs().empty()) {
-            proposal.source = "CognitionExploration";
+            static const SourceId COGNITION_EXPLORATION = internSource("CognitionExploration");
+            proposal.source = COGNITION_EXPLORATION;
             proposal.description = "Scan environment for entities.";
             proposal.priority = 1.5; 
             proposal.execute = [this]() {
-                if (action_mgr_) action_mgr_->execute(Eigen::VectorXd::Zero(6), "HeadScan");
+                if (action_mgr_) action_mgr_->executeNamed("HeadScan");
             };
         }
 
         return proposal;
     }
     // --- 3. 生成当前时刻的行为提案 ---
-    // --- [核心集成点]：提案生成与 RAG 策略检索 ---
+    // 每个 tick 调用，不分配: RAG 策略检索与 LLM Prompt 构建只在触发规划时进行 (triggerPlanning)，
+    // 这里只把已解析的任务目标映射到世界模型中的位置。
     ActionProposal getBestProposal(const titan::core::FusedContext& ctx, titan::cognition::ObjectCognitionEngine& cognition) {
+        static const SourceId EXECUTIVE = internSource("Executive");
         ActionProposal proposal;
+        proposal.source = EXECUTIVE;
         
         // 如果没有活跃任务，返回空提案
         if (current_task_.status != TaskStatus::ACTIVE) {
-            proposal.source = "Executive";
             proposal.description = "Idle, awaiting command.";
             proposal.priority = 1.0;
             return proposal;
         }
 
-        // A. 构建 LLM 的上下文 (Context)
-        std::string task_context = current_task_.goal + " | Current Step: " + current_task_.current_step;
-        
-        std::string recent_history;
-        if (cognitive_stream_) {
-            // 从流中获取历史，但只取最近几秒的高级事件
-            recent_history = cognitive_stream_->buildContextPrompt();
-        }
-        
-        // B. [RAG 检索]：从策略库中获取相关经验
-        std::string relevant_strategies;
-        if (strategy_optimizer_) {
-            // 这是注入的关键目的：根据当前任务和历史，检索最相关的策略。
-            // 
-            relevant_strategies = strategy_optimizer_->retrieveRelevantStrategies(task_context, recent_history);
-        }
-        
-        // C. 构建最终 Prompt
-        std::string prompt_for_llm;
-        prompt_for_llm += "### LEARNED STRATEGIES ###\n" + relevant_strategies;
-        prompt_for_llm += "\n### COGNITIVE STREAM ###\n" + recent_history;
-        prompt_for_llm += "\n### TASK & WORLD ###\n" + task_context;
-        
-        // D. LLM 规划 (通常是异步操作)
-        // 假设这里调用了一个同步/异步接口来获取下一步 Action (Plan/Act Loop)
-        // std::string next_action = llm_planner_.plan(prompt_for_llm);
-        
-        // [Mock 结果]
-        auto location = getTopDownTargetLocation(cognition);
-        std::string next_action{""};
-        if (location.has_value()) {
-            next_action = "MoveTo(" + vectorToString(location.value()) + ")";
-        } 
-        
-        // E. 生成提案
-        proposal.source = "Executive";
-        proposal.description = "Executing: " + next_action;
+        // [Mock 结果] 下一步动作: 移动到目标实体
         proposal.priority = 5.0; // 中高优先级
-        proposal.execute = [this, next_action]() {
-            // 实际执行逻辑：调用 ActionManager
-            this->performExecutiveAction(next_action); 
+        auto location = getTopDownTargetLocation(cognition);
+        if (!location) {
+            proposal.description = "Executing: ";
+            proposal.execute = [this]() { this->performExecutiveAction(""); };
+            return proposal;
+        }
+
+        const Eigen::Vector3d target = *location;
+        proposal.description.format("Executing: MoveTo(%.3f, %.3f, %.3f)", target.x(), target.y(), target.z());
+        proposal.execute = [this, target]() {
+            // 实际执行逻辑：调用 ActionManager (指令文本在赢得仲裁后才生成)
+            this->performExecutiveAction("MoveTo(" + vectorToString(target) + ")");
         };
-        
         return proposal;
     }
     /**
@@ -382,36 +368,12 @@ public:
             return std::nullopt;
         }
 
-        std::string goal = current_task_.goal;
-        std::transform(goal.begin(), goal.end(), goal.begin(), ::tolower); // 转换为小写，便于匹配
-
-        // 2. [语义解析] 简单启发式：提取目标关键词 (Mock LLM Planning)
-        std::string target_keyword;
-        
-        if (goal.find("cup") != std::string::npos || goal.find("mug") != std::string::npos) {
-            target_keyword = "cup";
-        } else if (goal.find("box") != std::string::npos || goal.find("container") != std::string::npos) {
-            target_keyword = "box";
-        } else if (goal.find("person") != std::string::npos || goal.find("user") != std::string::npos) {
-            target_keyword = "person";
-        }
-        // ... 更多关键词规则 ...
-        
-        if (target_keyword.empty()) {
-            std::cerr << "[Executive] Could not parse a valid target keyword from the goal." << std::endl;
-            return std::nullopt;
-        }
-
-        // 3. [世界模型查询] 查找匹配的实体
-        auto potential_targets = cognition.findByCategory(target_keyword);
-
-        if (potential_targets.empty()) {
-            // 如果 WorldModel 说没找到，返回空
-            return std::nullopt;
-        }
+        // 2. [语义解析] goal 变化时才重新解析
+        parseGoal();
+        if (target_keyword_.empty()) return std::nullopt;
 
-        // 4. [属性过滤与决策] 找出最佳匹配目标
-        // 目标：找到最符合语义和最近的实体。
+        // 3. [世界模型查询] 遍历匹配的实体 (不构造结果数组)
+        // 4. [属性过滤与决策] 边遍历边找出最佳匹配目标：最符合语义和最近的实体。
 
         titan::core::WorldEntity* best_entity = nullptr;
         double min_distance_sq = std::numeric_limits<double>::max();
@@ -420,37 +382,66 @@ public:
         // 假设当前机器人位置为 (0, 0, 0)
         Eigen::Vector3d robot_pos = Eigen::Vector3d::Zero(); 
 
-        for (auto* entity : potential_targets) {
+        cognition.forEachInCategory(target_keyword_, [&](titan::core::WorldEntity& entity) {
+            if (found_specific_attribute) return;   // 已有明确匹配 (贪婪策略)
+
             // A. 处理颜色属性 (例如 "red cup")
-            if (goal.find("red") != std::string::npos) {
-                auto it = entity->knowledge_graph.find("color");
-                if (it != entity->knowledge_graph.end() && it->second.value == "red" && it->second.confidence > 0.7) {
-                    best_entity = entity;
+            if (target_wants_red_) {
+                auto it = entity.knowledge_graph.find("color");
+                if (it != entity.knowledge_graph.end() && it->second.value == "red" && it->second.confidence > 0.7) {
+                    best_entity = &entity;
                     found_specific_attribute = true;
-                    break; // 如果找到明确匹配，立即返回 (贪婪策略)
+                    return;
                 }
             }
             
             // B. 如果没有特定属性要求，则选择最近的
-            double dist_sq = (entity->position - robot_pos).squaredNorm();
-            if (!found_specific_attribute && dist_sq < min_distance_sq) {
+            double dist_sq = (entity.position - robot_pos).squaredNorm();
+            if (dist_sq < min_distance_sq) {
                 min_distance_sq = dist_sq;
-                best_entity = entity;
+                best_entity = &entity;
             }
-        }
+        });
 
         // 5. 返回结果
         if (best_entity) {
-            // 记录思维事件 (可选)
-            if (cognitive_stream_) {
+            // 记录思维事件 (只在解析到的实体变化时)
+            if (cognitive_stream_ && best_entity->track_id != resolved_track_id_) {
                 cognitive_stream_->addEvent(titan::core::EventType::THOUGHT_CHAIN, 
                     "Resolved target: Entity ID " + std::to_string(best_entity->track_id) + " (" + best_entity->category + ")");
             }
+            resolved_track_id_ = best_entity->track_id;
             return best_entity->position;
         }
 
         return std::nullopt;
     }
+
+    // 任务目标 -> 目标类别关键词 (简单启发式，Mock LLM Planning)；结果缓存到 goal 变化为止
+    void parseGoal() {
+        if (parsed_goal_ == current_task_.goal) return;
+        parsed_goal_ = current_task_.goal;
+        resolved_track_id_ = -1;
+
+        std::string goal = parsed_goal_;
+        std::transform(goal.begin(), goal.end(), goal.begin(), ::tolower); // 转换为小写，便于匹配
+
+        target_keyword_.clear();
+        if (goal.find("cup") != std::string::npos || goal.find("mug") != std::string::npos) {
+            target_keyword_ = "cup";
+        } else if (goal.find("box") != std::string::npos || goal.find("container") != std::string::npos) {
+            target_keyword_ = "box";
+        } else if (goal.find("person") != std::string::npos || goal.find("user") != std::string::npos) {
+            target_keyword_ = "person";
+        }
+        // ... 更多关键词规则 ...
+        target_wants_red_ = goal.find("red") != std::string::npos;
+
+        if (target_keyword_.empty()) {
+            std::cerr << "[Executive] Could not parse a valid target keyword from the goal." << std::endl;
+        }
+    }
+
     void performExecutiveAction(const std::string& action) {
         // 记录思维事件
         if (cognitive_stream_) {
@@ -458,7 +449,7 @@ public:
         }
         // ... 调用 ActionManager 执行 ...
         if (action_mgr_) {
-            action_mgr_->execute(Eigen::VectorXd::Zero(6), action);
+            action_mgr_->executeNamed(action);
         }
     }
 
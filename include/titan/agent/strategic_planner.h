@@ -19,12 +19,18 @@ public:
     void injectMemory(titan::memory::EntityMemoryManager* mem) { memory_manager_ = mem; }
     // --- 增强版规划接口 ---
     void planWithMemory(const std::string& user_goal, int target_entity_id) {
-        
+        planWithMemory(user_goal, std::vector<int>{target_entity_id});
+    }
+
+    // 涉及多个实体时一次批量取上下文 (预序列化的缓存，同一版本重复规划不再序列化)
+    void planWithMemory(const std::string& user_goal, const std::vector<int>& target_entity_ids) {
+        if (!memory_manager_) return;
+
         // 1. 从记忆中提取上下文
-        json entity_ctx = memory_manager_->getEntityContext(target_entity_id);
+        auto entity_ctxs = memory_manager_->getEntityContexts(target_entity_ids);
         
         // 2. 构建包含记忆的 Prompt
-        std::string prompt = buildPrompt(user_goal, entity_ctx);
+        std::string prompt = buildPrompt(user_goal, entity_ctxs);
         
         // 3. 调用 LLM
         // ... call LLM ...
@@ -32,7 +38,7 @@ public:
 private:
     std::future<OptimizationResult> planning_future_;
     bool is_optimizing_ = false;
-    titan::memory::EntityMemoryManager* memory_manager_;
+    titan::memory::EntityMemoryManager* memory_manager_ = nullptr;
 public:
     bool isBusy() const { return is_optimizing_; }
 
@@ -117,19 +123,24 @@ private:
         ss << "4. Output JSON.";
         return ss.str();
     }
-    std::string buildPrompt(const std::string& goal, const json& memory) {
-        std::stringstream ss;
-        ss << "You are a helpful robot assistant.\n";
-        ss << "User Goal: " << goal << "\n";
+    std::string buildPrompt(const std::string& goal,
+                            const std::vector<titan::memory::EntityMemoryManager::ContextPtr>& memories) {
+        std::string prompt;
+        prompt.reserve(512);
+        prompt += "You are a helpful robot assistant.\n";
+        prompt += "User Goal: " + goal + "\n";
         
-        ss << "Target Entity Profile:\n";
-        ss << "- Attributes: " << memory["attributes"].dump() << "\n";
-        ss << "- Recent Events: " << memory["recent_history"].dump() << "\n";
+        for (const auto& memory : memories) {
+            if (!memory) continue;
+            prompt += "Target Entity Profile (ID " + std::to_string(memory->entity_id) + "):\n";
+            prompt += "- Attributes: " + memory->attributes + "\n";
+            prompt += "- Recent Events: " + memory->recent_history + "\n";
+        }
         
-        ss << "Decision Logic:\n";
-        ss << "Check the entity's recent history. If the user's goal conflicts with the entity's current state, propose a polite strategy.\n";
+        prompt += "Decision Logic:\n";
+        prompt += "Check the entity's recent history. If the user's goal conflicts with the entity's current state, propose a polite strategy.\n";
         
-        return ss.str();
+        return prompt;
     }
 };
 
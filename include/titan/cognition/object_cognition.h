@@ -1,6 +1,7 @@
 #pragma once
 
 #include "titan/core/types.h"
+#include <string_view>
 #include <vector>
 #include <list>
 #include <string>
@@ -125,12 +126,16 @@ public:
     // 根据类别搜索 (支持模糊匹配)
     std::vector<WorldEntity*> findByCategory(const std::string& category_keyword) {
         std::vector<WorldEntity*> results;
+        forEachInCategory(category_keyword, [&results](WorldEntity& e) { results.push_back(&e); });
+        return results;
+    }
+
+    // 同上，但按访问者回调逐个交出，不构造结果数组 (每个 tick 调用的路径用这个)
+    template <typename Fn>
+    void forEachInCategory(std::string_view category_keyword, Fn&& fn) {
         for (auto& e : entities_) {
-            if (e.category.find(category_keyword) != std::string::npos) {
-                results.push_back(&e);
-            }
+            if (e.category.find(category_keyword) != std::string::npos) fn(e);
         }
-        return results;
     }
 
 private:
@@ -1,61 +1,392 @@
 #pragma once
 #include "titan/core/types.h"
+#include "titan/core/ring_buffer.h"
+#include "titan/core/realtime.h"
+#include "titan/core/async_logger.h"
 #include "hal/hardware_drivers.h"
-#include <mutex>
-#include <optional>
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
 
 namespace titan::control {
 
+// 行为执行通道
+//
+// 认知线程 (生产者) 与内环线程 (消费者) 之间没有互斥锁:
+//   - execute()/executeTrajectory()/setMode(): 给指令分配递增的 ActionId，写入 SPSC 指令队列后立即返回
+//   - controlCycle(): 内环每周期调用，取出指令、推进轨迹并下发驱动，根据驱动反馈
+//     (指令到位 / 堵转) 推进状态；状态通过 SeqLock 发布。内环 FEP 求解出的力与速度上限 (Effort)
+//     也在这里转交驱动
+//   - getStatus()/isBusy(): 只读一次 SeqLock，不取时间、不查询驱动
+// 没有驱动 (driver 为 nullptr，例如仿真) 时单条指令在被内环取走时即视为完成，轨迹照常按时间推进。
+//
+// 轨迹执行:
+//   认知层以 "目标点 + 时长" 的段为单位流式提交，内环把它们放进预览缓冲，每周期做三次 Hermite 插值。
+//   从静止开始的轨迹以实测关节状态 (observeJointState) 为起点，之后段起点的位置/速度取上一段终点 (C1 连续)；
+//   段终点速度在该段开始时按 Catmull-Rom 由下一段估计，所以只要预览缓冲里始终至少还有一段，经过路点时不会停顿。REPLACE 丢弃尚未开始的段，
+//   并从当前插值状态 (位置 + 速度) 平滑过渡到新的第一段，不需要先停下。
 class ActionManager {
 public:
     enum class ActionStatus { IDLE, RUNNING, SUCCEEDED, FAILED };
+    enum class BodyMode : uint8_t { NORMAL, CRAWL };
+    enum class TrajectoryMode { APPEND, REPLACE };
+    using ActionId = uint64_t;
+
+    static constexpr size_t MAX_DOF = 16;
+    static constexpr size_t COMMAND_QUEUE = 256;
+    static constexpr size_t PREVIEW_CAPACITY = 256;
+    static constexpr double CRAWL_TIME_SCALE = 0.3;   // 爬行模式下轨迹按 30% 速度播放
+
+    struct Status {
+        ActionId id = 0;
+        ActionStatus status = ActionStatus::IDLE;
+    };
+
+    // 内环控制器 (FEP) 本周期的输出；inactive 时驱动收到零力
+    struct Effort {
+        double force = 0.0;
+        double velocity_limit = 0.0;
+        bool active = false;
+    };
+
+    // 轨迹段: 在 duration_s 内从上一段终点运动到 target
+    struct Waypoint {
+        Eigen::VectorXd target;
+        double duration_s;
+    };
 
 private:
+    enum class CommandKind : uint8_t { SETPOINT, SEGMENT, MODE, NAMED };
+
+    struct Command {
+        ActionId id = 0;
+        CommandKind kind = CommandKind::SETPOINT;
+        bool replace = false;    // SEGMENT: 该批次的第一段，替换预览缓冲
+        bool last = false;       // SEGMENT: 该批次的最后一段
+        BodyMode mode = BodyMode::NORMAL;
+        uint32_t dof = 0;
+        double duration = 0.0;
+        std::array<double, MAX_DOF> values{};
+    };
+
+    using Vec = std::array<double, MAX_DOF>;
+
+    // 实测关节状态 (传感器线程发布)
+    struct JointState {
+        uint32_t dof = 0;
+        Vec pos{}, vel{};
+    };
+
     titan::hal::RobotBodyDriver* driver_;
-    
-    struct CurrentAction {
-        std::string name; // e.g., "Grasp"
-        ActionStatus status;
-        titan::core::TimePoint start_time;
-    } current_act_;
-    
-    std::mutex mtx_;
+
+    // --- 认知线程独占 ---
+    ActionId next_id_ = 1;
+    ActionId last_submitted_ = 0;
+    std::string current_name_;   // e.g., "Grasp"
+
+    // --- 线程间通道 ---
+    titan::core::SpscRing<Command> commands_{COMMAND_QUEUE};
+    titan::core::SeqLock<Status> status_;
+    titan::core::SeqLock<JointState> measured_;
+
+    // --- 内环线程独占 (预分配) ---
+    Status active_;
+    Eigen::VectorXd out_buf_{Eigen::VectorXd::Zero(6)};
+    BodyMode mode_ = BodyMode::NORMAL;
+
+    titan::core::FixedRing<Command> preview_{PREVIEW_CAPACITY};
+    bool tracking_ = false;      // 正在执行轨迹
+    bool seg_active_ = false;
+    uint32_t dof_ = 0;           // 当前指令状态的维度 (0 表示未知)
+    Vec pos_{}, vel_{};          // 当前插值状态
+    Vec p0_{}, v0_{}, p1_{}, v1_{};
+    double seg_t_ = 0.0, seg_T_ = 0.0;
+    ActionId rejected_batch_ = 0;   // 预览缓冲溢出而整批失败的轨迹，其余段直接丢弃
+
+    void publish(ActionStatus s) {
+        if (active_.status == s) return;
+        active_.status = s;
+        status_.store(active_);
+    }
+
+    void beginAction(ActionId id) {
+        active_.id = id;
+        active_.status = ActionStatus::IDLE;   // 强制发布新状态
+    }
+
+    ActionId submit(Command& c, const std::string& act_name) {
+        c.id = next_id_;
+        if (!commands_.tryPush(c)) {
+            titan::core::AsyncLogger::instance().log("[Action] Command queue full, dropped " + act_name);
+            return 0;
+        }
+        ++next_id_;
+        last_submitted_ = c.id;
+        current_name_ = act_name;
+        return c.id;
+    }
+
+    void send(const Vec& values, uint32_t dof, ActionId id) {
+        if (!driver_) return;
+        if (out_buf_.size() != static_cast<Eigen::Index>(dof)) out_buf_.resize(dof);   // 只在维度变化时
+        std::copy(values.begin(), values.begin() + dof, out_buf_.data());
+        driver_->setCommand(out_buf_, id);
+    }
+
+    void stopTrajectory() {
+        preview_.clear();
+        tracking_ = false;
+        seg_active_ = false;
+        seg_t_ = 0.0;
+        vel_.fill(0.0);
+    }
+
+    // 从静止开始的轨迹以实测位姿为起点 (上一条指令可能没有到位，或者根本还没下发过指令)
+    bool seedFromMeasurement(uint32_t dof) {
+        JointState m = measured_.load();
+        if (m.dof != dof) return false;
+        dof_ = dof;
+        pos_ = m.pos;
+        vel_ = m.vel;
+        return true;
+    }
+
+    // 从当前状态开始预览缓冲中的下一段
+    void startSegment() {
+        const Command& seg = preview_.front();
+        if (dof_ != seg.dof && !seedFromMeasurement(seg.dof)) {
+            // 既没有已知的指令状态也没有实测数据: 只能把第一个路点当作当前位置
+            titan::core::AsyncLogger::instance().log("[Action] No joint state for trajectory start, jumping to first waypoint");
+            dof_ = seg.dof;
+            pos_ = seg.values;
+            vel_.fill(0.0);
+        }
+        p0_ = pos_;
+        v0_ = vel_;
+        p1_ = seg.values;
+        seg_T_ = std::max(seg.duration, 1e-3);
+        seg_t_ = 0.0;
+
+        // Catmull-Rom: 终点速度由下一段决定；没有下一段则在终点停下
+        v1_.fill(0.0);
+        if (preview_.size() > 1 && preview_[1].dof == dof_) {
+            const Command& next = preview_[1];
+            double span = seg_T_ + std::max(next.duration, 1e-3);
+            for (uint32_t i = 0; i < dof_; ++i) v1_[i] = (next.values[i] - p0_[i]) / span;
+        }
+        preview_.pop_front();
+        seg_active_ = true;
+    }
+
+    void evaluateSegment() {
+        double s = std::clamp(seg_t_ / seg_T_, 0.0, 1.0);
+        double s2 = s * s, s3 = s2 * s;
+        double h00 = 2 * s3 - 3 * s2 + 1, h10 = s3 - 2 * s2 + s, h01 = -2 * s3 + 3 * s2, h11 = s3 - s2;
+        double d00 = 6 * s2 - 6 * s, d10 = 3 * s2 - 4 * s + 1, d01 = -6 * s2 + 6 * s, d11 = 3 * s2 - 2 * s;
+        for (uint32_t i = 0; i < dof_; ++i) {
+            pos_[i] = h00 * p0_[i] + h10 * seg_T_ * v0_[i] + h01 * p1_[i] + h11 * seg_T_ * v1_[i];
+            vel_[i] = (d00 * p0_[i] + d10 * seg_T_ * v0_[i] + d01 * p1_[i] + d11 * seg_T_ * v1_[i]) / seg_T_;
+        }
+    }
+
+    void advanceTrajectory(double dt) {
+        seg_t_ += dt * (mode_ == BodyMode::CRAWL ? CRAWL_TIME_SCALE : 1.0);
+        while (!seg_active_ || seg_t_ >= seg_T_) {
+            double carry = seg_active_ ? seg_t_ - seg_T_ : seg_t_;   // 空闲时 seg_t_ 从 0 开始累计
+            if (seg_active_) {
+                pos_ = p1_;
+                vel_ = v1_;
+                seg_active_ = false;
+            }
+            if (preview_.empty()) {
+                // 轨迹走完: 停在终点
+                tracking_ = false;
+                vel_.fill(0.0);
+                seg_t_ = 0.0;
+                send(pos_, dof_, active_.id);
+                // 有驱动时等终点指令的到位反馈；当前行为已被判定失败 (例如后续批次溢出) 时不覆盖
+                if (!driver_ && active_.status == ActionStatus::RUNNING) publish(ActionStatus::SUCCEEDED);
+                return;
+            }
+            startSegment();
+            seg_t_ = carry;
+        }
+        evaluateSegment();
+        send(pos_, dof_, active_.id);
+    }
+
+    void consume(const Command& c) {
+        switch (c.kind) {
+        case CommandKind::SETPOINT:
+            // 单条指令打断轨迹
+            stopTrajectory();
+            beginAction(c.id);
+            dof_ = c.dof;
+            pos_ = c.values;
+            send(pos_, dof_, c.id);
+            publish(driver_ ? ActionStatus::RUNNING : ActionStatus::SUCCEEDED);
+            break;
+        case CommandKind::SEGMENT:
+            if (c.id == rejected_batch_) break;
+            if (c.replace) {
+                // 丢弃未开始的段；当前段在此处截断，新的第一段从当前位置/速度出发
+                preview_.clear();
+                if (seg_active_) {
+                    evaluateSegment();
+                    seg_active_ = false;
+                    seg_t_ = 0.0;
+                }
+            }
+            if (!tracking_ && !seg_active_ && preview_.empty()) seedFromMeasurement(c.dof);   // 从静止出发
+            if (preview_.full()) {
+                // 整批失败: 撤回已入缓冲的本批次段，其余段到达时丢弃；状态必须落到 FAILED，否则 getStatus() 永远是 RUNNING
+                titan::core::AsyncLogger::instance().log("[Action] Trajectory preview full, rejected trajectory batch");
+                while (!preview_.empty() && preview_.back().id == c.id) preview_.pop_back();
+                rejected_batch_ = c.id;
+                beginAction(c.id);
+                publish(ActionStatus::FAILED);
+                break;
+            }
+            preview_.push_back(c);
+            if (c.last) {
+                beginAction(c.id);
+                publish(ActionStatus::RUNNING);
+                tracking_ = true;
+            }
+            break;
+        case CommandKind::MODE:
+            mode_ = c.mode;
+            beginAction(c.id);
+            publish(ActionStatus::SUCCEEDED);
+            break;
+        case CommandKind::NAMED:
+            // 没有对应的运动基元库，离散指令只记录完成
+            beginAction(c.id);
+            publish(ActionStatus::SUCCEEDED);
+            break;
+        }
+    }
 
 public:
-    explicit ActionManager(titan::hal::RobotBodyDriver* d) : driver_(d) {}
+    explicit ActionManager(titan::hal::RobotBodyDriver* d) : driver_(d) {
+        if (!driver_) titan::core::AsyncLogger::instance().log("[Action] No body driver attached, actions are simulated");
+    }
 
-    // 发送指令
-    void execute(const Eigen::VectorXd& cmd, const std::string& act_name) {
-        std::lock_guard<std::mutex> lock(mtx_);
-        driver_->setCommand(cmd);
-        
-        current_act_.name = act_name;
-        current_act_.status = ActionStatus::RUNNING;
-        current_act_.start_time = std::chrono::steady_clock::now();
+    // 发送单条指令 (认知线程)；会打断正在执行的轨迹。队列满时返回 0，指令被丢弃
+    ActionId execute(const Eigen::VectorXd& cmd, const std::string& act_name) {
+        Command c;
+        c.kind = CommandKind::SETPOINT;
+        c.dof = static_cast<uint32_t>(std::min<Eigen::Index>(cmd.size(), MAX_DOF));
+        std::copy(cmd.data(), cmd.data() + c.dof, c.values.begin());
+        return submit(c, act_name);
     }
 
-    // 查询当前行为状态 (供 Reasoning 使用)
-    ActionStatus getStatus() {
-        std::lock_guard<std::mutex> lock(mtx_);
-        // 简单模拟：如果执行超过 2秒，认为成功
-        auto now = std::chrono::steady_clock::now();
-        if (current_act_.status == ActionStatus::RUNNING) {
-             if (std::chrono::duration<double>(now - current_act_.start_time).count() > 2.0) {
-                 current_act_.status = ActionStatus::SUCCEEDED;
-             }
+    // 流式提交轨迹段 (认知线程)。APPEND 接在预览缓冲末尾；REPLACE 替换所有尚未执行的部分。
+    // 整批要么全部入队，要么 (队列空间不足或超过 PREVIEW_CAPACITY 段时) 全部拒绝并返回 0。
+    // APPEND 时若预览缓冲放不下本批次，整批以 FAILED 结束。
+    ActionId executeTrajectory(const std::vector<Waypoint>& segments, const std::string& act_name,
+                               TrajectoryMode mode = TrajectoryMode::APPEND) {
+        if (segments.empty()) return 0;
+        if (segments.size() > PREVIEW_CAPACITY) {
+            titan::core::AsyncLogger::instance().log("[Action] Trajectory longer than preview buffer (" +
+                                                     std::to_string(segments.size()) + " segments), rejected " + act_name);
+            return 0;
+        }
+        if (commands_.capacity() - commands_.sizeApprox() < segments.size()) {
+            titan::core::AsyncLogger::instance().log("[Action] Command queue full, dropped trajectory " + act_name);
+            return 0;
         }
-        
-        // 如果底层驱动报错 (如 STALLED)，则行为失败
-        if (driver_->getState() == titan::core::ComponentState::STALLED) {
-            current_act_.status = ActionStatus::FAILED;
+        const ActionId id = next_id_;
+        for (size_t i = 0; i < segments.size(); ++i) {
+            Command c;
+            c.id = id;
+            c.kind = CommandKind::SEGMENT;
+            c.replace = (i == 0 && mode == TrajectoryMode::REPLACE);
+            c.last = (i + 1 == segments.size());
+            c.dof = static_cast<uint32_t>(std::min<Eigen::Index>(segments[i].target.size(), MAX_DOF));
+            c.duration = segments[i].duration_s;
+            std::copy(segments[i].target.data(), segments[i].target.data() + c.dof, c.values.begin());
+            commands_.tryPush(c);   // 空间已预先检查 (只有本线程入队)
         }
+        ++next_id_;
+        last_submitted_ = id;
+        current_name_ = act_name;
+        return id;
+    }
+
+    // 实测关节状态 (传感器线程，单写者)；速度缺失时按 0 处理
+    void observeJointState(const Eigen::VectorXd& pos, const Eigen::VectorXd& vel) {
+        JointState m;
+        m.dof = static_cast<uint32_t>(std::min<Eigen::Index>(pos.size(), MAX_DOF));
+        std::copy(pos.data(), pos.data() + m.dof, m.pos.begin());
+        if (vel.size() >= static_cast<Eigen::Index>(m.dof)) std::copy(vel.data(), vel.data() + m.dof, m.vel.begin());
+        measured_.store(m);
+    }
 
-        return current_act_.status;
+    ActionId setMode(BodyMode mode) {
+        Command c;
+        c.kind = CommandKind::MODE;
+        c.mode = mode;
+        return submit(c, mode == BodyMode::CRAWL ? "SetMode:CRAWL" : "SetMode:NORMAL");
     }
 
-    bool isBusy() {
+    // 按名字下发离散行为: "STOP" 停止一切运动，"SetMode:<NORMAL|CRAWL>" 切换模式，其余作为离散动作记录
+    ActionId executeNamed(const std::string& act_name) {
+        if (act_name == "STOP") return execute(Eigen::VectorXd::Zero(6), act_name);
+        if (act_name == "SetMode:CRAWL") return setMode(BodyMode::CRAWL);
+        if (act_name == "SetMode:NORMAL") return setMode(BodyMode::NORMAL);
+        Command c;
+        c.kind = CommandKind::NAMED;
+        return submit(c, act_name);
+    }
+
+    // 内环每周期调用 (消费者)，dt 为控制周期 (秒)
+    void controlCycle(double dt) { controlCycle(dt, Effort{}); }
+    void controlCycle(double dt, const Effort& effort) {
+        // 0. 力输出
+        if (driver_) driver_->setEffort(effort.active ? effort.force : 0.0, effort.active ? effort.velocity_limit : 0.0);
+
+        // 1. 取出所有新指令
+        Command c;
+        while (commands_.tryPop(c)) consume(c);
+
+        // 2. 轨迹插值
+        if (tracking_ || seg_active_) advanceTrajectory(dt);
+
+        // 3. 驱动反馈推进状态
+        if (!driver_ || active_.status != ActionStatus::RUNNING) return;
+        auto fb = driver_->feedback();
+        if (fb.command_id != active_.id) return;   // 驱动还没处理到这条指令 (反馈属于上一条)
+        if (fb.state == titan::core::ComponentState::STALLED) {
+            stopTrajectory();
+            publish(ActionStatus::FAILED);   // 堵转即失败
+        } else if (fb.reached && !tracking_ && !seg_active_) {
+            publish(ActionStatus::SUCCEEDED);
+        }
+    }
+
+    // 查询当前行为状态 (供 Reasoning 使用)
+    // 已提交但内环尚未取走的指令也算 RUNNING
+    ActionStatus getStatus() const {
+        Status s = status_.load();
+        if (s.id < last_submitted_) return ActionStatus::RUNNING;
+        return s.status;
+    }
+
+    // 查询指定指令；被更新的指令覆盖后返回 IDLE
+    ActionStatus getStatus(ActionId id) const {
+        Status s = status_.load();
+        if (id > s.id) return ActionStatus::RUNNING;
+        return id == s.id ? s.status : ActionStatus::IDLE;
+    }
+
+    bool isBusy() const {
         return getStatus() == ActionStatus::RUNNING;
     }
+
+    const std::string& currentAction() const { return current_name_; }
+    bool hasDriver() const { return driver_ != nullptr; }
 };
 
-} // namespace titan::control
\ No newline at end of file
+} // namespace titan::control
@@ -0,0 +1,91 @@
+#pragma once
+#include "titan/control/fep_controller.h"
+#include "titan/core/realtime.h"
+#include <array>
+#include <atomic>
+#include <functional>
+#include <thread>
+
+namespace titan::control {
+
+// 1 kHz 内环执行器
+//
+// 认知层 (100 Hz tick) 只通过 SeqLock 邮箱写入最新设定点，从不等待内环；
+// 内环线程按绝对截止时间 (clock_nanosleep) 每周期读取设定点、调用 FEPController::solve，
+// 把输出写进另一个邮箱并调用周期钩子 (ActionManager 在这里下发指令与力输出)。
+// 特征向量与 predict 的工作区在内环线程启动时按上限分配好，周期内不分配内存。
+class ControlLoop {
+public:
+    static constexpr size_t MAX_FEATURES = 32;
+
+    struct Options {
+        std::chrono::microseconds period{1000};
+        titan::core::RealtimeOptions rt;   // 默认不提权；需要时设置 SCHED_FIFO 优先级 / CPU 绑定
+    };
+
+    struct Setpoint {
+        std::array<double, MAX_FEATURES> features{};
+        uint32_t dim = 0;
+        bool active = false;   // false: 保持 (输出零力)
+    };
+
+    struct Output {
+        double force = 0.0;
+        double velocity_limit = 0.0;
+        bool is_exploring = false;
+        bool active = false;
+        uint64_t cycle = 0;
+    };
+
+    struct Stats {
+        uint64_t cycles = 0;
+        uint64_t overruns = 0;          // 唤醒延迟 + 计算耗时超过一个周期
+        uint64_t missed_periods = 0;    // 因超时被跳过的周期
+        double mean_jitter_us = 0.0;    // 唤醒时刻相对截止时刻的延迟
+        double max_jitter_us = 0.0;
+        double mean_compute_us = 0.0;
+        double max_compute_us = 0.0;
+    };
+
+    // 每周期在内环线程上调用；必须是实时安全的 (不加锁、不分配、不做 IO)
+    using CycleHook = std::function<void(const Output&)>;
+
+    explicit ControlLoop(FEPController& controller) : ControlLoop(controller, Options{}) {}
+    ControlLoop(FEPController& controller, const Options& opts);
+    ~ControlLoop();
+
+    ControlLoop(const ControlLoop&) = delete;
+    ControlLoop& operator=(const ControlLoop&) = delete;
+
+    // 只能在 start() 之前设置
+    void setCycleHook(CycleHook hook);
+
+    bool start();
+    void stop();
+    bool running() const { return running_.load(std::memory_order_acquire); }
+    std::chrono::microseconds period() const { return opts_.period; }
+
+    // --- 认知层接口 (单写者) ---
+    // 特征维度超过 MAX_FEATURES 时拒绝并返回 false
+    bool setSetpoint(const Eigen::VectorXd& features);
+    void hold();
+
+    Output latestOutput() const { return output_.load(); }
+    Stats stats() const { return stats_.load(); }
+
+private:
+    FEPController& controller_;
+    Options opts_;
+    CycleHook hook_;
+
+    titan::core::SeqLock<Setpoint> setpoint_;
+    titan::core::SeqLock<Output> output_;
+    titan::core::SeqLock<Stats> stats_;
+
+    std::atomic<bool> running_{false};
+    std::thread worker_;
+
+    void loop();
+};
+
+} // namespace titan::control
@@ -1,9 +1,28 @@
 #pragma once
 #include "titan/memory/sparse_gp_memory.h"
+#include "titan/memory/gp_hyper_optimizer.h"
+#include "titan/core/epoch.h"
 #include <Eigen/Dense>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
 
 namespace titan::control {
 
+// 自由能原理控制器
+//
+// 线程模型 (RCU):
+//   - learn() 只把样本放进有界队列后返回；专用学习线程批量写入 muscle_memory_、
+//     处理后台超参数结果与检查点，然后发布一份不可变的 GPPredictor 快照 (只含预测所需的有效部分)
+//   - solve() 通过 AtomicSnapshot 无锁读取当前快照做预测，旧快照由 EpochDomain 延迟回收
+//   因此 solve 的最坏耗时只取决于快照大小 (O(n²))，与学习负载无关
+//
+// 内存上界: 每份快照约 8·(d·n + n² + 2n + d) 字节 (默认 n = 100)。学习线程每批最多发布一次，
+// 发布后立即回收，除当前快照外只会留下仍被某次 solve() 读着的旧快照 (每个并发 solve 至多一份)。
 class FEPController {
 public:
     struct ControlOutput {
@@ -15,7 +34,10 @@ public:
     FEPController();
     ~FEPController();
 
-    ControlOutput solve(const Eigen::VectorXd& perception_features);
+    ControlOutput solve(const Eigen::VectorXd& perception_features);   // 使用线程局部的工作区
+    // 内环用: 工作区由调用方预先分配 (makeWorkspace)，稳态不分配内存
+    ControlOutput solve(const Eigen::VectorXd& perception_features, titan::memory::GPPredictor::Workspace& ws);
+    titan::memory::GPPredictor::Workspace makeWorkspace(size_t max_features) const;
     void learn(const Eigen::VectorXd& features, double actual_best, double pred_val);
 
     // [新增] 外部干预接口
@@ -25,10 +47,45 @@ public:
     void updateInternalState();
 
 private:
+    struct Sample {
+        Eigen::VectorXd features;
+        double actual_best;
+        double surprise;
+    };
+
+    // --- 学习侧状态: 构造完成后只由 learner_ 线程访问 ---
     titan::memory::SparseGPMemory muscle_memory_;
 
+    // 肌肉记忆持久化: 启动时加载，学习过程中定期落盘，析构时再保存一次
+    const std::string MEMORY_PATH = "muscle.bin";
+    const std::chrono::seconds CHECKPOINT_INTERVAL{30};
+    std::chrono::steady_clock::time_point last_checkpoint_ = std::chrono::steady_clock::now();
+    bool dirty_ = false;
+
+    // 超参数在后台线程优化；learn 中取回结果并定期提交新的数据快照，solve 不受影响
+    titan::memory::GPHyperOptimizer hyper_opt_;
+    const std::chrono::seconds HYPER_INTERVAL{10};
+    std::chrono::steady_clock::time_point last_hyper_submit_ = std::chrono::steady_clock::now();
+
+    // --- 控制侧读取的快照 (epoch_ 必须先于 model_ 构造、晚于其析构) ---
+    titan::core::EpochDomain epoch_;
+    titan::core::AtomicSnapshot<titan::memory::GPPredictor> model_;
+
+    // --- 样本队列 ---
+    static constexpr size_t MAX_PENDING_SAMPLES = 256;   // 学习线程跟不上时丢弃最旧的样本
+    const std::chrono::milliseconds LEARNER_POLL{100};   // 没有样本时也定期取回超参数结果
+    std::mutex sample_mtx_;
+    std::condition_variable sample_cv_;
+    std::deque<Sample> samples_;
+    bool running_ = true;
+    std::thread learner_;   // 最后声明: 启动时其他成员都已就绪
+
+    void learnerLoop();
+    void maintain(std::chrono::steady_clock::time_point now);   // 超参数 + 检查点
+
     // 稳定性因子: 0.1 (极其保守) ~ 1.0 (全速运行)
-    double stability_factor_ = 1.0;
+    // 认知线程写 (唯一写者)，内环线程在 solve 中读
+    std::atomic<double> stability_factor_{1.0};
     
     // 参数配置
     const double MIN_STABILITY = 0.2;
@@ -0,0 +1,83 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace titan::core {
+
+// 异步日志
+// 热路径 (感知写入、控制循环、仲裁) 只把已经格式化好的行放进队列，不做任何 IO；
+// 后台线程批量写 stdout。队列满时丢弃并计数，绝不阻塞调用方。
+class AsyncLogger {
+public:
+    static constexpr size_t MAX_PENDING = 4096;
+
+private:
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::vector<std::string> pending_;
+    std::atomic<uint64_t> dropped_{0};
+    bool running_ = true;
+    std::thread worker_;
+
+    void workerLoop() {
+        std::vector<std::string> batch;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                cv_.wait(lock, [this] { return !pending_.empty() || !running_; });
+                if (pending_.empty() && !running_) break;
+                batch.swap(pending_);
+            }
+            for (const auto& line : batch) std::cout << line << '\n';
+            uint64_t lost = dropped_.exchange(0, std::memory_order_relaxed);
+            if (lost > 0) std::cout << "[Log] dropped " << lost << " lines\n";
+            std::cout.flush();
+            batch.clear();
+        }
+    }
+
+    AsyncLogger() {
+        pending_.reserve(256);
+        worker_ = std::thread(&AsyncLogger::workerLoop, this);
+    }
+
+public:
+    ~AsyncLogger() {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            running_ = false;
+        }
+        cv_.notify_one();
+        if (worker_.joinable()) worker_.join();
+    }
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    static AsyncLogger& instance() {
+        static AsyncLogger logger;
+        return logger;
+    }
+
+    void log(std::string line) {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (pending_.size() >= MAX_PENDING) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            pending_.push_back(std::move(line));
+        }
+        cv_.notify_one();
+    }
+
+    uint64_t droppedCount() const { return dropped_.load(std::memory_order_relaxed); }
+};
+
+} // namespace titan::core
@@ -0,0 +1,162 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace titan::core {
+
+// 基于 epoch 的延迟回收 (RCU 风格)
+//
+// 读者: pin() 占一个读者槽位并记下当前全局 epoch，之后可以无锁读取受保护的指针，
+//       Guard 析构时释放槽位。读者之间、读者与写者之间都没有锁。
+// 写者: 先原子替换指针，再 retire() 旧对象；只有当所有活跃读者的 epoch 都晚于退休时刻，
+//       旧对象才会被真正释放。
+//
+// 读者槽位数固定 (MAX_READERS)，槽位用完时 pin() 自旋等待。读者不应长时间持有 Guard，
+// 需要长期持有的数据应在 Guard 内拷贝出 shared_ptr。
+class EpochDomain {
+public:
+    static constexpr size_t MAX_READERS = 64;
+    static constexpr size_t RECLAIM_THRESHOLD = 32;   // 退休列表达到该长度时尝试回收
+
+private:
+    static constexpr uint64_t IDLE = ~uint64_t{0};
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{IDLE};
+    };
+
+    std::atomic<uint64_t> global_{1};
+    std::array<Slot, MAX_READERS> slots_;
+
+    std::mutex retire_mtx_;
+    std::vector<std::pair<uint64_t, std::function<void()>>> retired_;
+
+    uint64_t minActiveEpoch() const {
+        uint64_t min_epoch = IDLE;
+        for (const auto& s : slots_) {
+            uint64_t e = s.epoch.load(std::memory_order_seq_cst);
+            if (e < min_epoch) min_epoch = e;
+        }
+        return min_epoch;
+    }
+
+    // 调用方持有 retire_mtx_
+    void reclaimLocked() {
+        uint64_t safe = minActiveEpoch();
+        size_t kept = 0;
+        for (auto& r : retired_) {
+            if (r.first < safe) {
+                r.second();
+            } else {
+                retired_[kept++] = std::move(r);
+            }
+        }
+        retired_.resize(kept);
+    }
+
+public:
+    class Guard {
+    private:
+        Slot* slot_ = nullptr;
+
+    public:
+        explicit Guard(Slot* slot) : slot_(slot) {}
+        ~Guard() {
+            if (slot_) slot_->epoch.store(IDLE, std::memory_order_release);
+        }
+        Guard(Guard&& o) noexcept : slot_(o.slot_) { o.slot_ = nullptr; }
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+        Guard& operator=(Guard&&) = delete;
+    };
+
+    EpochDomain() = default;
+    ~EpochDomain() {
+        std::lock_guard<std::mutex> lock(retire_mtx_);
+        for (auto& r : retired_) r.second();
+        retired_.clear();
+    }
+
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+
+    Guard pin() {
+        while (true) {
+            for (auto& s : slots_) {
+                uint64_t expected = IDLE;
+                uint64_t now = global_.load(std::memory_order_seq_cst);
+                if (s.epoch.compare_exchange_strong(expected, now, std::memory_order_seq_cst)) {
+                    return Guard(&s);
+                }
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    // 旧对象已经从所有共享指针上摘下后调用
+    void retire(std::function<void()> deleter) {
+        uint64_t e = global_.fetch_add(1, std::memory_order_seq_cst);
+        std::lock_guard<std::mutex> lock(retire_mtx_);
+        retired_.emplace_back(e, std::move(deleter));
+        if (retired_.size() >= RECLAIM_THRESHOLD) reclaimLocked();
+    }
+
+    void reclaim() {
+        std::lock_guard<std::mutex> lock(retire_mtx_);
+        reclaimLocked();
+    }
+};
+
+// 由 EpochDomain 保护的不可变快照指针
+// 写者 publish() 新版本 (写者之间需要调用方自行互斥)；读者 read() 拿到的指针在返回的 Reader 存活期间有效。
+template <typename T>
+class AtomicSnapshot {
+private:
+    EpochDomain& domain_;
+    std::atomic<const T*> ptr_;
+
+public:
+    class Reader {
+    private:
+        EpochDomain::Guard guard_;
+        const T* ptr_;
+
+    public:
+        Reader(EpochDomain::Guard&& g, const T* p) : guard_(std::move(g)), ptr_(p) {}
+        const T* get() const { return ptr_; }
+        const T* operator->() const { return ptr_; }
+        const T& operator*() const { return *ptr_; }
+    };
+
+    AtomicSnapshot(EpochDomain& domain, std::unique_ptr<const T> initial)
+        : domain_(domain), ptr_(initial.release()) {}
+    ~AtomicSnapshot() { delete ptr_.load(std::memory_order_acquire); }
+
+    AtomicSnapshot(const AtomicSnapshot&) = delete;
+    AtomicSnapshot& operator=(const AtomicSnapshot&) = delete;
+
+    Reader read() const {
+        auto guard = domain_.pin();
+        return Reader(std::move(guard), ptr_.load(std::memory_order_seq_cst));
+    }
+
+    // 写者侧直接读取当前版本 (调用方持有写锁，当前版本不会被替换)
+    const T* current() const { return ptr_.load(std::memory_order_acquire); }
+
+    // 调用方已经持有同一 EpochDomain 的 Reader 时使用 (嵌套读取不必重复 pin)
+    const T* readPinned() const { return ptr_.load(std::memory_order_seq_cst); }
+
+    void publish(std::unique_ptr<const T> next) {
+        const T* old = ptr_.exchange(next.release(), std::memory_order_seq_cst);
+        if (old) domain_.retire([old] { delete old; });
+    }
+};
+
+} // namespace titan::core
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <string_view>
+
+namespace titan::core {
+
+// 定长内联字符串: 超出容量时截断，从不分配
+// 用于每个 tick 都会重新生成的短文本 (提案描述等)
+template <size_t N>
+class FixedString {
+    static_assert(N > 1, "FixedString needs room for at least one character");
+
+private:
+    char buf_[N];
+    size_t len_ = 0;
+
+public:
+    FixedString() { buf_[0] = '\0'; }
+    FixedString(std::string_view s) { assign(s); }
+    FixedString(const char* s) { assign(s); }
+
+    FixedString& operator=(std::string_view s) {
+        assign(s);
+        return *this;
+    }
+    FixedString& operator=(const char* s) {
+        assign(s);
+        return *this;
+    }
+
+    void assign(std::string_view s) {
+        len_ = s.size() < N - 1 ? s.size() : N - 1;
+        std::memcpy(buf_, s.data(), len_);
+        buf_[len_] = '\0';
+    }
+
+    // printf 风格格式化 (截断到容量)
+    __attribute__((format(printf, 2, 3))) void format(const char* fmt, ...) {
+        va_list args;
+        va_start(args, fmt);
+        int n = std::vsnprintf(buf_, N, fmt, args);
+        va_end(args);
+        len_ = n < 0 ? 0 : (static_cast<size_t>(n) < N ? static_cast<size_t>(n) : N - 1);
+        buf_[len_] = '\0';
+    }
+
+    void clear() {
+        len_ = 0;
+        buf_[0] = '\0';
+    }
+
+    bool empty() const { return len_ == 0; }
+    size_t size() const { return len_; }
+    static constexpr size_t capacity() { return N - 1; }
+    const char* c_str() const { return buf_; }
+    std::string_view view() const { return {buf_, len_}; }
+    operator std::string_view() const { return view(); }
+};
+
+template <size_t N>
+std::ostream& operator<<(std::ostream& os, const FixedString<N>& s) {
+    return os << s.view();
+}
+
+} // namespace titan::core
@@ -0,0 +1,108 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace titan::core {
+
+template <typename Signature, size_t Capacity = 64>
+class InlineFunction;
+
+// 定长内联存储的可调用对象 (std::function 的无分配替代)
+//
+// 闭包直接构造在对象内部的 Capacity 字节缓冲里，超出容量在编译期报错，绝不回退到堆分配。
+// 只支持移动 (闭包可以持有 std::string 等只需移动的捕获)；空对象调用为空操作 (返回值类型需可默认构造)。
+template <typename R, typename... Args, size_t Capacity>
+class InlineFunction<R(Args...), Capacity> {
+private:
+    struct Ops {
+        R (*invoke)(void*, Args&&...);
+        void (*move)(void* dst, void* src);   // 移动构造到 dst 并析构 src
+        void (*destroy)(void*);
+    };
+
+    template <typename F>
+    static const Ops* opsFor() {
+        static const Ops ops{
+            [](void* p, Args&&... args) -> R { return (*static_cast<F*>(p))(std::forward<Args>(args)...); },
+            [](void* dst, void* src) {
+                new (dst) F(std::move(*static_cast<F*>(src)));
+                static_cast<F*>(src)->~F();
+            },
+            [](void* p) { static_cast<F*>(p)->~F(); },
+        };
+        return &ops;
+    }
+
+    alignas(std::max_align_t) unsigned char storage_[Capacity];
+    const Ops* ops_ = nullptr;
+
+    void reset() {
+        if (ops_) ops_->destroy(storage_);
+        ops_ = nullptr;
+    }
+
+public:
+    InlineFunction() = default;
+    InlineFunction(std::nullptr_t) {}
+
+    template <typename F, typename D = std::decay_t<F>,
+              typename = std::enable_if_t<!std::is_same_v<D, InlineFunction> && std::is_invocable_r_v<R, D&, Args...>>>
+    InlineFunction(F&& f) {
+        static_assert(sizeof(D) <= Capacity, "closure too large for InlineFunction; capture less or raise Capacity");
+        static_assert(alignof(D) <= alignof(std::max_align_t), "over-aligned closure");
+        new (storage_) D(std::forward<F>(f));
+        ops_ = opsFor<D>();
+    }
+
+    InlineFunction(InlineFunction&& o) noexcept {
+        if (o.ops_) {
+            o.ops_->move(storage_, o.storage_);
+            ops_ = o.ops_;
+            o.ops_ = nullptr;
+        }
+    }
+
+    InlineFunction& operator=(InlineFunction&& o) noexcept {
+        if (this != &o) {
+            reset();
+            if (o.ops_) {
+                o.ops_->move(storage_, o.storage_);
+                ops_ = o.ops_;
+                o.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    template <typename F, typename D = std::decay_t<F>,
+              typename = std::enable_if_t<!std::is_same_v<D, InlineFunction> && std::is_invocable_r_v<R, D&, Args...>>>
+    InlineFunction& operator=(F&& f) {
+        reset();
+        static_assert(sizeof(D) <= Capacity, "closure too large for InlineFunction; capture less or raise Capacity");
+        static_assert(alignof(D) <= alignof(std::max_align_t), "over-aligned closure");
+        new (storage_) D(std::forward<F>(f));
+        ops_ = opsFor<D>();
+        return *this;
+    }
+
+    InlineFunction& operator=(std::nullptr_t) {
+        reset();
+        return *this;
+    }
+
+    InlineFunction(const InlineFunction&) = delete;
+    InlineFunction& operator=(const InlineFunction&) = delete;
+
+    ~InlineFunction() { reset(); }
+
+    explicit operator bool() const { return ops_ != nullptr; }
+
+    R operator()(Args... args) const {
+        if (!ops_) return R();
+        return ops_->invoke(const_cast<unsigned char*>(storage_), std::forward<Args>(args)...);
+    }
+};
+
+} // namespace titan::core
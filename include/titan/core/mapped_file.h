@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace titan::core {
+
+// 只读内存映射文件 (POSIX mmap)
+// 用于日志回放 / 快照加载：按需分页，不把整个文件读进堆内存。
+class MappedFile {
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path) { open(path); }
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& o) noexcept : data_(o.data_), size_(o.size_) { o.data_ = nullptr; o.size_ = 0; }
+    MappedFile& operator=(MappedFile&& o) noexcept {
+        if (this != &o) {
+            close();
+            data_ = o.data_; size_ = o.size_;
+            o.data_ = nullptr; o.size_ = 0;
+        }
+        return *this;
+    }
+
+    // sequential = true 时提示内核做顺序预读 (回放场景)
+    bool open(const std::string& path, bool sequential = true) {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        void* p = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // 映射建立后 fd 可以立即关闭
+        if (p == MAP_FAILED) return false;
+
+        data_ = static_cast<const uint8_t*>(p);
+        size_ = static_cast<size_t>(st.st_size);
+        if (sequential) ::madvise(p, size_, MADV_SEQUENTIAL);
+        return true;
+    }
+
+    void close() {
+        if (data_) ::munmap(const_cast<uint8_t*>(data_), size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    bool valid() const { return data_ != nullptr; }
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+};
+
+} // namespace titan::core
@@ -2,6 +2,11 @@
 #include "types.h"
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <vector>
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
 
 namespace titan::core {
 
@@ -36,4 +41,83 @@ public:
     }
 };
 
+// --- 向量运算 (Embedding 检索的热路径) ---
+// AVX2+FMA 可用时走 8 路 SIMD (编译参数 -march=native)，否则退化为可自动向量化的标量循环
+class VectorMath {
+public:
+    static float dot(const float* a, const float* b, size_t n) {
+#if defined(__AVX2__) && defined(__FMA__)
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+            acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+        }
+        for (; i + 8 <= n; i += 8) {
+            acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        }
+        acc0 = _mm256_add_ps(acc0, acc1);
+        __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc0), _mm256_extractf128_ps(acc0, 1));
+        s = _mm_hadd_ps(s, s);
+        s = _mm_hadd_ps(s, s);
+        float sum = _mm_cvtss_f32(s);
+        for (; i < n; ++i) sum += a[i] * b[i];
+        return sum;
+#else
+        float s0 = 0.f, s1 = 0.f, s2 = 0.f, s3 = 0.f;
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            s0 += a[i] * b[i];
+            s1 += a[i + 1] * b[i + 1];
+            s2 += a[i + 2] * b[i + 2];
+            s3 += a[i + 3] * b[i + 3];
+        }
+        for (; i < n; ++i) s0 += a[i] * b[i];
+        return (s0 + s1) + (s2 + s3);
+#endif
+    }
+
+    // int8 编码与 fp32 查询的点积 (非对称量化检索)
+    static float dotInt8(const int8_t* a, const float* b, size_t n) {
+#if defined(__AVX2__) && defined(__FMA__)
+        __m256 acc = _mm256_setzero_ps();
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m128i c = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(a + i));
+            __m256 af = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(c));
+            acc = _mm256_fmadd_ps(af, _mm256_loadu_ps(b + i), acc);
+        }
+        __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+        s = _mm_hadd_ps(s, s);
+        s = _mm_hadd_ps(s, s);
+        float sum = _mm_cvtss_f32(s);
+        for (; i < n; ++i) sum += a[i] * b[i];
+        return sum;
+#else
+        float sum = 0.f;
+        for (size_t i = 0; i < n; ++i) sum += a[i] * b[i];
+        return sum;
+#endif
+    }
+
+    // 原地归一化，返回原始范数 (零向量保持为零)
+    static float normalize(float* v, size_t n) {
+        float norm = std::sqrt(dot(v, v, n));
+        if (norm > 0.f) {
+            float inv = 1.f / norm;
+            for (size_t i = 0; i < n; ++i) v[i] *= inv;
+        }
+        return norm;
+    }
+
+    static float cosineSimilarity(const std::vector<float>& a, const std::vector<float>& b) {
+        if (a.size() != b.size() || a.empty()) return 0.f;
+        float na = dot(a.data(), a.data(), a.size());
+        float nb = dot(b.data(), b.data(), b.size());
+        if (na <= 0.f || nb <= 0.f) return 0.f;
+        return dot(a.data(), b.data(), a.size()) / std::sqrt(na * nb);
+    }
+};
+
 } // namespace titan::core
\ No newline at end of file
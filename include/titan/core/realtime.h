@@ -0,0 +1,159 @@
+#pragma once
+#include "titan/core/async_logger.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <cerrno>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <time.h>
+
+namespace titan::core {
+
+// --- 顺序锁邮箱 (单写者 / 多读者，无锁) ---
+//
+// 写者: 序号变为奇数 -> 写数据 -> 序号变为偶数，不会被读者阻塞
+// 读者: 读序号 -> 读数据 -> 再读序号，两次一致且为偶数才采用，否则重试 (写入只有几十纳秒)
+// 数据按 8 字节字以原子量存放，避免数据竞争；T 必须可平凡拷贝。
+// 多个写者时需要调用方自行互斥。
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable_v<T>, "SeqLock payload must be trivially copyable");
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+private:
+    alignas(64) std::atomic<uint64_t> seq_{0};
+    std::array<std::atomic<uint64_t>, WORDS> data_{};
+
+public:
+    SeqLock() { store(T{}); }
+    explicit SeqLock(const T& initial) { store(initial); }
+
+    SeqLock(const SeqLock&) = delete;
+    SeqLock& operator=(const SeqLock&) = delete;
+
+    void store(const T& value) {
+        uint64_t words[WORDS] = {};
+        std::memcpy(words, &value, sizeof(T));
+
+        uint64_t s = seq_.load(std::memory_order_relaxed);
+        seq_.store(s + 1, std::memory_order_relaxed);
+        // 数据字用 release 写: 读者看到任何一个新字时也一定能看到奇数序号
+        for (size_t i = 0; i < WORDS; ++i) data_[i].store(words[i], std::memory_order_release);
+        seq_.store(s + 2, std::memory_order_release);
+    }
+
+    T load() const {
+        uint64_t words[WORDS];
+        while (true) {
+            uint64_t s0 = seq_.load(std::memory_order_acquire);
+            if (s0 & 1) continue;   // 写者正在写
+            // acquire 读保证第二次读序号不会被提前到数据读取之前 (x86 上与普通 load 相同)
+            for (size_t i = 0; i < WORDS; ++i) words[i] = data_[i].load(std::memory_order_acquire);
+            if (seq_.load(std::memory_order_relaxed) == s0) break;
+        }
+        T value;
+        std::memcpy(&value, words, sizeof(T));
+        return value;
+    }
+
+    // 已完成的写入次数 (读者可以据此判断是否有新数据)
+    uint64_t version() const { return seq_.load(std::memory_order_acquire) >> 1; }
+};
+
+// --- 绝对截止时间的周期定时器 ---
+//
+// 用 clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME) 睡到 "上一个截止时刻 + 周期"，
+// 计算耗时和调度延迟不会像 sleep_for(period) 那样逐周期累积成漂移。
+// 某个周期超时后直接跳到下一个未来的截止时刻 (不连发补偿)，并报告错过的周期数。
+class PeriodicTimer {
+public:
+    struct Wake {
+        int64_t lateness_ns = 0;   // 实际唤醒时刻 - 截止时刻 (抖动；超时后为超出的时间)
+        uint32_t missed = 0;       // 因超时而跳过的周期数
+    };
+
+private:
+    int64_t period_ns_;
+    int64_t next_ns_ = 0;
+
+    static int64_t nowNs() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+    }
+
+public:
+    explicit PeriodicTimer(std::chrono::nanoseconds period) : period_ns_(period.count() > 0 ? period.count() : 1) {
+        reset();
+    }
+
+    // 以当前时刻为起点重新排期
+    void reset() { next_ns_ = nowNs() + period_ns_; }
+
+    int64_t periodNs() const { return period_ns_; }
+
+    Wake wait() {
+        timespec deadline;
+        deadline.tv_sec = static_cast<time_t>(next_ns_ / 1000000000LL);
+        deadline.tv_nsec = static_cast<long>(next_ns_ % 1000000000LL);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {
+        }
+
+        Wake w;
+        int64_t woke = nowNs();
+        w.lateness_ns = woke - next_ns_;
+        next_ns_ += period_ns_;
+        if (next_ns_ <= woke) {
+            int64_t behind = (woke - next_ns_) / period_ns_ + 1;
+            w.missed = static_cast<uint32_t>(behind);
+            next_ns_ += behind * period_ns_;
+        }
+        return w;
+    }
+};
+
+// --- 实时线程配置 ---
+struct RealtimeOptions {
+    int fifo_priority = 0;     // > 0 时切换到 SCHED_FIFO (需要 CAP_SYS_NICE)
+    int cpu = -1;              // >= 0 时绑定到该 CPU
+    bool lock_memory = false;  // mlockall，避免缺页打断实时循环
+};
+
+// 对调用线程生效；任何一步失败只记日志并返回 false，线程继续以普通优先级运行
+inline bool configureRealtimeThread(const RealtimeOptions& opts, const std::string& name) {
+    bool ok = true;
+    auto& log = AsyncLogger::instance();
+
+    if (opts.lock_memory && mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        log.log("[RT] " + name + ": mlockall failed (errno " + std::to_string(errno) + ")");
+        ok = false;
+    }
+    if (opts.cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(opts.cpu, &set);
+        int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (rc != 0) {
+            log.log("[RT] " + name + ": cannot pin to CPU " + std::to_string(opts.cpu) + " (error " + std::to_string(rc) + ")");
+            ok = false;
+        }
+    }
+    if (opts.fifo_priority > 0) {
+        sched_param sp{};
+        sp.sched_priority = opts.fifo_priority;
+        int rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+        if (rc != 0) {
+            log.log("[RT] " + name + ": SCHED_FIFO unavailable (error " + std::to_string(rc) + "), running best-effort");
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+} // namespace titan::core
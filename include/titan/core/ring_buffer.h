@@ -4,9 +4,115 @@
 #include <mutex>
 #include <optional>
 #include <algorithm>
+#include <atomic>
+#include <vector>
 
 namespace titan::core {
 
+// 定长环形缓冲 (单线程, 无锁)
+// 槽位在构造时一次性分配，之后 push/pop 只覆盖已有槽位，不再触发堆分配。
+// 下标 0 永远是最旧的元素。
+template <typename T>
+class FixedRing {
+private:
+    std::vector<T> slots_;
+    size_t head_ = 0;   // 最旧元素所在槽位
+    size_t size_ = 0;
+
+    size_t slot(size_t i) const { return (head_ + i) % slots_.size(); }
+
+public:
+    explicit FixedRing(size_t cap) : slots_(cap > 0 ? cap : 1) {}
+
+    size_t capacity() const { return slots_.size(); }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    bool full() const { return size_ == slots_.size(); }
+
+    // 追加一个槽位并返回其引用，由调用方原地填充。
+    // 满时覆盖最旧元素；需要做淘汰处理的调用方应先自行 pop_front()。
+    T& push_back() {
+        if (full()) {
+            head_ = slot(1);
+            --size_;
+        }
+        ++size_;
+        return slots_[slot(size_ - 1)];
+    }
+
+    void push_back(const T& item) { push_back() = item; }
+
+    void pop_front() {
+        if (empty()) return;
+        head_ = slot(1);
+        --size_;
+    }
+
+    void pop_back() {
+        if (empty()) return;
+        --size_;
+    }
+
+    T& front() { return slots_[head_]; }
+    const T& front() const { return slots_[head_]; }
+    T& back() { return slots_[slot(size_ - 1)]; }
+    const T& back() const { return slots_[slot(size_ - 1)]; }
+
+    T& operator[](size_t i) { return slots_[slot(i)]; }
+    const T& operator[](size_t i) const { return slots_[slot(i)]; }
+
+    void clear() { head_ = 0; size_ = 0; }
+};
+
+// 单生产者 / 单消费者无锁环形队列
+// 容量向上取整到 2 的幂；槽位在构造时一次性分配，push/pop 只做拷贝，不分配、不加锁。
+// 生产者和消费者各自只能有一个线程。
+template <typename T>
+class SpscRing {
+private:
+    std::vector<T> slots_;
+    size_t mask_;
+    alignas(64) std::atomic<size_t> head_{0};   // 消费者写
+    alignas(64) std::atomic<size_t> tail_{0};   // 生产者写
+
+    static size_t roundUp(size_t n) {
+        size_t cap = 2;
+        while (cap < n) cap <<= 1;
+        return cap;
+    }
+
+public:
+    explicit SpscRing(size_t cap) : slots_(roundUp(cap)), mask_(slots_.size() - 1) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    size_t capacity() const { return slots_.size(); }
+
+    // 生产者侧；满时返回 false
+    bool tryPush(const T& item) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == slots_.size()) return false;
+        slots_[tail & mask_] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 消费者侧；空时返回 false
+    bool tryPop(T& out) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) return false;
+        out = slots_[head & mask_];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 近似值 (另一侧可能正在修改)
+    size_t sizeApprox() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+};
+
 template <typename T>
 class RingTrack {
 private:
@@ -0,0 +1,240 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "titan/core/inline_function.h"
+
+namespace titan::core {
+
+// 静态任务图 (DAG) + 工作窃取线程池
+//
+// 构图: add(name, fn, deps) 只能依赖已经添加的节点，因此图天然无环；构图完成后每次 run() 执行一遍整张图。
+// 调度: 入度为 0 的节点先进入调用线程的队列。节点完成后，刚好就绪的后继压入当前工作者自己的队列
+//       (LIFO，数据还在缓存里)；空闲的工作者从其他队列的头部窃取 (FIFO)。
+// 汇合: run() 在所有节点完成后返回，调用线程本身也作为 0 号工作者参与执行；没有后台工作者时退化为按拓扑序串行执行。
+// 数据: 图本身不传递数据。节点把结果写进调用方预先准备的固定槽位，join 之后由调用方按固定顺序收集，
+//       输出顺序与调度顺序无关。run() 返回时所有节点的写入对调用线程可见。
+// 稳态 run() 不分配内存；不可重入，add() 不能与 run() 并发。
+class TaskGraph {
+public:
+    using NodeId = uint32_t;
+    using Task = InlineFunction<void(), 64>;
+
+    struct NodeStats {
+        std::string name;
+        double last_us = 0.0;
+        double avg_us = 0.0;   // 指数平均
+        double max_us = 0.0;
+    };
+
+    struct Stats {
+        uint64_t runs = 0;
+        double last_wall_us = 0.0;   // run() 的墙钟时间 (≈ 关键路径 + 调度开销)
+        double avg_wall_us = 0.0;
+        double max_wall_us = 0.0;
+        double last_work_us = 0.0;   // 最近一次各节点耗时之和 (串行执行的代价)
+        std::vector<NodeStats> nodes;
+    };
+
+private:
+    using Clock = std::chrono::steady_clock;
+    static constexpr double EMA_ALPHA = 0.1;
+
+    struct Node {
+        std::string name;
+        Task fn;
+        std::vector<NodeId> dependents;
+        uint32_t num_deps = 0;
+        std::atomic<uint32_t> pending{0};
+        double last_us = 0.0, avg_us = 0.0, max_us = 0.0;   // 只由执行该节点的线程写
+    };
+
+    struct alignas(64) Queue {
+        std::mutex mtx;
+        std::vector<NodeId> items;   // 尾部自己取，头部被窃取
+    };
+
+    std::deque<Node> nodes_;   // deque: 节点含原子量，不能随扩容移动
+    std::vector<NodeId> roots_;
+    std::unique_ptr<Queue[]> queues_;   // [0] 属于调用 run() 的线程
+    size_t num_queues_;
+
+    std::atomic<size_t> remaining_{0};
+    std::mutex wake_mtx_;
+    std::condition_variable wake_cv_;
+    uint64_t run_gen_ = 0;
+    bool stop_ = false;
+    std::vector<std::thread> workers_;
+
+    uint64_t runs_ = 0;
+    double last_wall_us_ = 0.0, avg_wall_us_ = 0.0, max_wall_us_ = 0.0;
+
+    void push(size_t self, NodeId id) {
+        std::lock_guard<std::mutex> lock(queues_[self].mtx);
+        queues_[self].items.push_back(id);
+    }
+
+    bool popLocal(size_t self, NodeId& id) {
+        std::lock_guard<std::mutex> lock(queues_[self].mtx);
+        auto& q = queues_[self].items;
+        if (q.empty()) return false;
+        id = q.back();
+        q.pop_back();
+        return true;
+    }
+
+    bool steal(size_t self, NodeId& id) {
+        for (size_t k = 1; k < num_queues_; ++k) {
+            Queue& victim = queues_[(self + k) % num_queues_];
+            std::lock_guard<std::mutex> lock(victim.mtx);
+            if (victim.items.empty()) continue;
+            id = victim.items.front();
+            victim.items.erase(victim.items.begin());   // 队列只有几个元素，线性移动可以接受
+            return true;
+        }
+        return false;
+    }
+
+    void execute(size_t self, NodeId id) {
+        Node& n = nodes_[id];
+        auto t0 = Clock::now();
+        n.fn();
+        double us = std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+        n.last_us = us;
+        n.avg_us = runs_ == 0 ? us : n.avg_us + EMA_ALPHA * (us - n.avg_us);
+        n.max_us = std::max(n.max_us, us);
+
+        for (NodeId d : n.dependents) {
+            // acq_rel: 后继看得到所有前驱的写入
+            if (nodes_[d].pending.fetch_sub(1, std::memory_order_acq_rel) == 1) push(self, d);
+        }
+        // 最后一个节点的 release 让 run() 看到整张图的结果
+        remaining_.fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    void drain(size_t self) {
+        NodeId id;
+        while (remaining_.load(std::memory_order_acquire) != 0) {
+            if (popLocal(self, id) || steal(self, id)) {
+                execute(self, id);
+            } else {
+                std::this_thread::yield();   // 图内等待前驱: 节点都是微秒到毫秒级，不值得睡眠
+            }
+        }
+    }
+
+    void workerMain(size_t self) {
+        uint64_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(wake_mtx_);
+                wake_cv_.wait(lock, [&] { return stop_ || run_gen_ != seen; });
+                if (stop_) return;
+                seen = run_gen_;
+            }
+            drain(self);
+        }
+    }
+
+public:
+    // workers: 后台工作者数量 (不含调用线程)；0 表示完全在调用线程上串行执行
+    explicit TaskGraph(size_t workers) : queues_(new Queue[workers + 1]), num_queues_(workers + 1) {
+        workers_.reserve(workers);
+        for (size_t i = 1; i <= workers; ++i) {
+            workers_.emplace_back(&TaskGraph::workerMain, this, i);
+        }
+    }
+
+    ~TaskGraph() {
+        {
+            std::lock_guard<std::mutex> lock(wake_mtx_);
+            stop_ = true;
+        }
+        wake_cv_.notify_all();
+        for (auto& t : workers_) {
+            if (t.joinable()) t.join();
+        }
+    }
+
+    TaskGraph(const TaskGraph&) = delete;
+    TaskGraph& operator=(const TaskGraph&) = delete;
+
+    // 推荐的工作者数量: 图的最大宽度减去调用线程，且不超过剩余核数
+    static size_t suggestedWorkers(size_t max_parallelism) {
+        size_t hw = std::thread::hardware_concurrency();
+        size_t spare = hw > 1 ? hw - 1 : 0;
+        return std::min(spare, max_parallelism > 0 ? max_parallelism - 1 : 0);
+    }
+
+    NodeId add(std::string name, Task fn, std::initializer_list<NodeId> deps = {}) {
+        NodeId id = static_cast<NodeId>(nodes_.size());
+        Node& n = nodes_.emplace_back();
+        n.name = std::move(name);
+        n.fn = std::move(fn);
+        for (NodeId d : deps) {
+            if (d >= id) continue;   // 只能依赖已有节点
+            nodes_[d].dependents.push_back(id);
+            ++n.num_deps;
+        }
+        if (n.num_deps == 0) roots_.push_back(id);
+        for (size_t q = 0; q < num_queues_; ++q) queues_[q].items.reserve(nodes_.size());
+        return id;
+    }
+
+    size_t size() const { return nodes_.size(); }
+    size_t workers() const { return workers_.size(); }
+
+    // 执行一遍整张图，全部节点完成后返回
+    void run() {
+        if (nodes_.empty()) return;
+        auto t0 = Clock::now();
+
+        for (auto& n : nodes_) n.pending.store(n.num_deps, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(queues_[0].mtx);
+            // 逆序压入: 调用线程从尾部取，先执行先添加的根节点
+            for (auto it = roots_.rbegin(); it != roots_.rend(); ++it) queues_[0].items.push_back(*it);
+        }
+        remaining_.store(nodes_.size(), std::memory_order_release);
+
+        if (!workers_.empty()) {
+            {
+                std::lock_guard<std::mutex> lock(wake_mtx_);
+                ++run_gen_;
+            }
+            wake_cv_.notify_all();
+        }
+        drain(0);
+
+        double wall = std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+        last_wall_us_ = wall;
+        avg_wall_us_ = runs_ == 0 ? wall : avg_wall_us_ + EMA_ALPHA * (wall - avg_wall_us_);
+        max_wall_us_ = std::max(max_wall_us_, wall);
+        ++runs_;
+    }
+
+    // 统计快照 (与 run() 在同一线程调用)
+    Stats stats() const {
+        Stats s;
+        s.runs = runs_;
+        s.last_wall_us = last_wall_us_;
+        s.avg_wall_us = avg_wall_us_;
+        s.max_wall_us = max_wall_us_;
+        s.nodes.reserve(nodes_.size());
+        for (const auto& n : nodes_) {
+            s.last_work_us += n.last_us;
+            s.nodes.push_back({n.name, n.last_us, n.avg_us, n.max_us});
+        }
+        return s;
+    }
+};
+
+} // namespace titan::core
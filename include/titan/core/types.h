@@ -112,6 +112,19 @@ enum class EventType {
     ACTION_VERBAL        // TTS 语音表达
 };
 
+// 事件类型在 Prompt 中的前缀标签
+inline const char* eventTypeTag(EventType type) {
+    switch(type) {
+        case EventType::PERCEPTION_VISUAL: return "[Eye]";
+        case EventType::PERCEPTION_AUDIO:  return "[Ear]";
+        case EventType::THOUGHT_CHAIN:     return "[Think]";
+        case EventType::DECISION_SWITCH:   return "[Decide]";
+        case EventType::ACTION_PHYSICAL:   return "[Act]";
+        case EventType::ACTION_VERBAL:     return "[Say]";
+        default: return "[Info]";
+    }
+}
+
 // 认知事件单元
 struct CognitiveEvent {
     TimePoint timestamp;
@@ -122,18 +135,8 @@ struct CognitiveEvent {
     
     // 序列化为字符串，用于构建 LLM Context
     std::string toString() const {
-        std::string prefix;
-        switch(type) {
-            case EventType::PERCEPTION_VISUAL: prefix = "[Eye]"; break;
-            case EventType::PERCEPTION_AUDIO:  prefix = "[Ear]"; break;
-            case EventType::THOUGHT_CHAIN:     prefix = "[Think]"; break;
-            case EventType::DECISION_SWITCH:   prefix = "[Decide]"; break;
-            case EventType::ACTION_PHYSICAL:   prefix = "[Act]"; break;
-            case EventType::ACTION_VERBAL:     prefix = "[Say]"; break;
-            default: prefix = "[Info]";
-        }
         // 格式: [T+1.2s] [Think] Planning to grasp cup...
-        return prefix + " " + summary;
+        return std::string(eventTypeTag(type)) + " " + summary;
     }
 };
 
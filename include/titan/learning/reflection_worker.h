@@ -0,0 +1,189 @@
+#pragma once
+#include "titan/learning/strategy_optimizer.h"
+#include "titan/core/async_logger.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace titan::learning {
+
+// 反思任务队列 + 固定大小的工作线程池
+//
+// tick 线程在任务结束时 submit() 一份 episode 日志的范围快照 (或没有日志时当前窗口已渲染的文本)，立即返回；
+// 工作线程从日志流式回放出文本，再调用 StrategyOptimizer 复盘 (其内部的策略写入由写锁串行化)，
+// 之后把任务成败回报给规划时用到的策略 (recordOutcome，含落盘，同样不在 tick 线程上)。
+// 回放和反序列化都不在 tick 线程上，耗时不随 episode 长度增长。
+// 队列有上限: 任务集中结束时丢弃最旧的未处理任务 (越新的经历越值得复盘)，并计数。
+class ReflectionWorker {
+public:
+    struct Options {
+        size_t workers = 2;
+        size_t max_queue = 16;
+    };
+
+    struct Stats {
+        size_t queue_depth = 0;
+        size_t in_flight = 0;
+        uint64_t submitted = 0;
+        uint64_t completed = 0;
+        uint64_t dropped = 0;
+        double avg_wait_ms = 0.0;     // 入队到开始处理
+        double avg_run_ms = 0.0;      // 单次反思耗时
+        double max_latency_ms = 0.0;  // 入队到处理完成
+    };
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Job {
+        titan::memory::EpisodeLog::Range range;   // 非空时从日志回放
+        std::string transcript;                   // 没有日志时: 当前窗口已渲染的文本
+        bool success;
+        std::vector<int> strategies;              // 本任务规划时用到的策略
+        Clock::time_point enqueued;
+    };
+
+    StrategyOptimizer& optimizer_;
+    Options opts_;
+
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<Job> queue_;
+    bool running_ = true;
+
+    // 统计 (受 mtx_ 保护)
+    size_t in_flight_ = 0;
+    uint64_t submitted_ = 0;
+    uint64_t completed_ = 0;
+    uint64_t dropped_ = 0;
+    double total_wait_ms_ = 0.0;
+    double total_run_ms_ = 0.0;
+    double max_latency_ms_ = 0.0;
+
+    std::vector<std::thread> workers_;
+
+    static double msBetween(Clock::time_point a, Clock::time_point b) {
+        return std::chrono::duration<double, std::milli>(b - a).count();
+    }
+
+    void workerLoop() {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                cv_.wait(lock, [this] { return !queue_.empty() || !running_; });
+                if (!running_) break;   // 关机时未开始的任务直接放弃
+                job = std::move(queue_.front());
+                queue_.pop_front();
+                ++in_flight_;
+            }
+
+            auto started = Clock::now();
+            if (!job.range.empty()) {
+                // 只拼出 prompt 需要的文本，不为每条事件构造 CognitiveEvent / json
+                std::string transcript;
+                titan::memory::EpisodeLog::replayRange(job.range, [&transcript](const titan::memory::LoggedEvent& evt) {
+                    transcript += titan::core::eventTypeTag(evt.type);
+                    transcript += ' ';
+                    transcript += evt.summary;
+                    transcript += '\n';
+                });
+                optimizer_.reflectOnTranscript(transcript, job.success);
+            } else {
+                optimizer_.reflectOnTranscript(job.transcript, job.success);
+            }
+            for (int id : job.strategies) optimizer_.recordOutcome(id, job.success);
+            auto finished = Clock::now();
+
+            std::lock_guard<std::mutex> lock(mtx_);
+            --in_flight_;
+            ++completed_;
+            total_wait_ms_ += msBetween(job.enqueued, started);
+            total_run_ms_ += msBetween(started, finished);
+            max_latency_ms_ = std::max(max_latency_ms_, msBetween(job.enqueued, finished));
+        }
+    }
+
+public:
+    explicit ReflectionWorker(StrategyOptimizer& optimizer) : ReflectionWorker(optimizer, Options{}) {}
+
+    ReflectionWorker(StrategyOptimizer& optimizer, const Options& opts) : optimizer_(optimizer), opts_(opts) {
+        size_t n = std::max<size_t>(1, opts_.workers);
+        workers_.reserve(n);
+        for (size_t i = 0; i < n; ++i) workers_.emplace_back(&ReflectionWorker::workerLoop, this);
+    }
+
+    ~ReflectionWorker() {
+        size_t abandoned;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            running_ = false;
+            abandoned = queue_.size();
+            queue_.clear();
+        }
+        cv_.notify_all();
+        for (auto& t : workers_) {
+            if (t.joinable()) t.join();
+        }
+        if (abandoned > 0) {
+            titan::core::AsyncLogger::instance().log("[Reflection] Shutdown with " + std::to_string(abandoned) +
+                                                     " pending episodes discarded");
+        }
+    }
+
+    ReflectionWorker(const ReflectionWorker&) = delete;
+    ReflectionWorker& operator=(const ReflectionWorker&) = delete;
+
+    // 非阻塞；range 由 CognitiveStream::episodeRange() 在写者线程生成
+    void submit(titan::memory::EpisodeLog::Range range, bool success, std::vector<int> strategies = {}) {
+        enqueue({std::move(range), {}, success, std::move(strategies), Clock::now()});
+    }
+
+    // 非阻塞；transcript 为每行一条事件的文本 (CognitiveStream::transcriptView())，由调用方按值交出
+    void submit(std::string transcript, bool success, std::vector<int> strategies = {}) {
+        enqueue({{}, std::move(transcript), success, std::move(strategies), Clock::now()});
+    }
+
+private:
+    void enqueue(Job&& job) {
+        bool dropped = false;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (!running_) return;
+            if (queue_.size() >= std::max<size_t>(1, opts_.max_queue)) {
+                queue_.pop_front();
+                ++dropped_;
+                dropped = true;
+            }
+            queue_.push_back(std::move(job));
+            ++submitted_;
+        }
+        cv_.notify_one();
+        if (dropped) titan::core::AsyncLogger::instance().log("[Reflection] Queue full, dropped oldest episode");
+    }
+
+public:
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        Stats s;
+        s.queue_depth = queue_.size();
+        s.in_flight = in_flight_;
+        s.submitted = submitted_;
+        s.completed = completed_;
+        s.dropped = dropped_;
+        if (completed_ > 0) {
+            s.avg_wait_ms = total_wait_ms_ / completed_;
+            s.avg_run_ms = total_run_ms_ / completed_;
+        }
+        s.max_latency_ms = max_latency_ms_;
+        return s;
+    }
+};
+
+} // namespace titan::learning
@@ -0,0 +1,259 @@
+#pragma once
+#include "titan/memory/quantized_store.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace titan::learning {
+
+// 策略检索索引
+//
+// 词法部分: 规则文本与标签分词后建倒排表 (词 -> [策略, 词频])，按 BM25 打分；
+//           查询时只遍历查询中出现的词的倒排表，代价与库大小基本无关。
+// 语义部分: 策略 Embedding 存在 QuantizedStore 里，有查询向量时与词法分数线性融合。
+// 最后乘以策略自身的先验权重 (使用频率等)，用大小为 k 的最小堆取 top-k。
+class StrategyIndex {
+public:
+    static constexpr uint32_t NO_EMBEDDING = titan::memory::QuantizedStore::NPOS;
+
+    struct Params {
+        double k1 = 1.2;
+        double b = 0.75;
+        uint32_t tag_boost = 3;       // 标签词按该倍数计入词频
+        double embedding_weight = 2.0; // 余弦相似度 (只取正值) 的融合权重
+    };
+
+    struct Hit {
+        int id;
+        double score;
+    };
+
+private:
+    struct Posting {
+        uint32_t doc;
+        uint32_t tf;
+    };
+
+    struct Doc {
+        int id = 0;
+        bool live = false;
+        uint32_t length = 0;          // 加权后的词数
+        uint32_t embedding_row = NO_EMBEDDING;
+        double prior = 1.0;
+        std::vector<uint32_t> terms;  // 出现过的词 (删除/更新时清理倒排表)
+    };
+
+    Params params_;
+    std::unordered_map<std::string, uint32_t> term_ids_;
+    std::vector<std::vector<Posting>> postings_;   // term id -> postings
+    std::vector<Doc> docs_;
+    std::vector<uint32_t> free_docs_;
+    std::unordered_map<int, uint32_t> doc_of_;     // 策略 ID -> doc 槽位
+    uint64_t total_length_ = 0;
+    size_t live_docs_ = 0;
+
+    // 查询期的临时状态: 每个线程一份 (复用，避免每次分配)，search() 因此可以并发调用。
+    // 不同索引实例共用同一份也没关系: acc 用完即清零，词标记靠递增的 gen 区分。
+    struct Scratch {
+        std::vector<double> acc;
+        std::vector<uint32_t> touched;
+        std::vector<uint32_t> term_mark;
+        uint32_t mark_gen = 0;
+        std::string token;
+    };
+    static Scratch& scratch() {
+        thread_local Scratch s;
+        return s;
+    }
+
+    // 小写 ASCII 字母数字切词；其余字符都视为分隔符
+    template <typename Fn>
+    static void forEachToken(std::string_view text, std::string& token, Fn&& fn) {
+        size_t i = 0;
+        while (i < text.size()) {
+            while (i < text.size() && !std::isalnum(static_cast<unsigned char>(text[i]))) ++i;
+            if (i >= text.size()) break;
+            token.clear();
+            while (i < text.size() && std::isalnum(static_cast<unsigned char>(text[i]))) {
+                token.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(text[i]))));
+                ++i;
+            }
+            fn(token);
+        }
+    }
+
+    uint32_t termId(const std::string& token) {
+        auto it = term_ids_.find(token);
+        if (it != term_ids_.end()) return it->second;
+        uint32_t id = static_cast<uint32_t>(postings_.size());
+        term_ids_.emplace(token, id);
+        postings_.emplace_back();
+        return id;
+    }
+
+    void unindex(uint32_t slot) {
+        Doc& d = docs_[slot];
+        for (uint32_t t : d.terms) {
+            auto& list = postings_[t];
+            list.erase(std::remove_if(list.begin(), list.end(), [slot](const Posting& p) { return p.doc == slot; }),
+                       list.end());
+        }
+        total_length_ -= d.length;
+        d.terms.clear();
+        d.length = 0;
+    }
+
+    double avgLength() const {
+        return live_docs_ > 0 ? static_cast<double>(total_length_) / live_docs_ : 1.0;
+    }
+
+public:
+    StrategyIndex() = default;
+    explicit StrategyIndex(const Params& params) : params_(params) {}
+
+    size_t size() const { return live_docs_; }
+
+    // 新增或整体替换一条策略的索引内容
+    void upsert(int id, std::string_view rule_text, const std::vector<std::string>& tags,
+                uint32_t embedding_row = NO_EMBEDDING, double prior = 1.0) {
+        uint32_t slot;
+        auto it = doc_of_.find(id);
+        if (it != doc_of_.end()) {
+            slot = it->second;
+            unindex(slot);
+        } else {
+            if (!free_docs_.empty()) {
+                slot = free_docs_.back();
+                free_docs_.pop_back();
+            } else {
+                slot = static_cast<uint32_t>(docs_.size());
+                docs_.emplace_back();
+            }
+            doc_of_[id] = slot;
+            ++live_docs_;
+        }
+
+        // 先在局部表里累计词频，再写入倒排表 (每个词每篇文档一条 posting)
+        std::unordered_map<uint32_t, uint32_t> tf;
+        std::string token;
+        forEachToken(rule_text, token, [&](const std::string& tok) { ++tf[termId(tok)]; });
+        for (const auto& tag : tags) {
+            forEachToken(tag, token, [&](const std::string& tok) { tf[termId(tok)] += params_.tag_boost; });
+        }
+
+        Doc& d = docs_[slot];
+        d.id = id;
+        d.live = true;
+        d.embedding_row = embedding_row;
+        d.prior = prior;
+        d.terms.clear();
+        d.length = 0;
+        for (const auto& [term, count] : tf) {
+            postings_[term].push_back({slot, count});
+            d.terms.push_back(term);
+            d.length += count;
+        }
+        total_length_ += d.length;
+    }
+
+    void remove(int id) {
+        auto it = doc_of_.find(id);
+        if (it == doc_of_.end()) return;
+        uint32_t slot = it->second;
+        unindex(slot);
+        docs_[slot].live = false;
+        docs_[slot].embedding_row = NO_EMBEDDING;
+        free_docs_.push_back(slot);
+        doc_of_.erase(it);
+        --live_docs_;
+    }
+
+    void setPrior(int id, double prior) {
+        auto it = doc_of_.find(id);
+        if (it != doc_of_.end()) docs_[it->second].prior = prior;
+    }
+
+    // 检索 top-k；embeddings/query 为空时只用词法分数
+    // 只读，可与其他 search() 并发 (与 upsert/remove 之间由调用方互斥)
+    std::vector<Hit> search(std::string_view text, size_t k, double min_score = 0.0,
+                            const titan::memory::QuantizedStore* embeddings = nullptr,
+                            const titan::memory::QuantizedStore::Query* query = nullptr) const {
+        if (k == 0 || live_docs_ == 0) return {};
+        Scratch& sc = scratch();
+        if (sc.acc.size() < docs_.size()) sc.acc.resize(docs_.size(), 0.0);
+        if (sc.term_mark.size() < postings_.size()) sc.term_mark.resize(postings_.size(), 0);
+        if (++sc.mark_gen == 0) {
+            std::fill(sc.term_mark.begin(), sc.term_mark.end(), 0);
+            sc.mark_gen = 1;
+        }
+        sc.touched.clear();
+        auto touch = [&sc](uint32_t slot, double s) {
+            if (sc.acc[slot] == 0.0) sc.touched.push_back(slot);
+            sc.acc[slot] += s;
+        };
+
+        // 1. BM25 (查询中重复出现的词只计一次)
+        const double n = static_cast<double>(live_docs_);
+        const double avg_len = avgLength();
+        forEachToken(text, sc.token, [&](const std::string& tok) {
+            auto it = term_ids_.find(tok);
+            if (it == term_ids_.end()) return;
+            uint32_t term = it->second;
+            if (sc.term_mark[term] == sc.mark_gen) return;
+            sc.term_mark[term] = sc.mark_gen;
+
+            const auto& list = postings_[term];
+            if (list.empty()) return;
+            double df = static_cast<double>(list.size());
+            double idf = std::log(1.0 + (n - df + 0.5) / (df + 0.5));
+            for (const auto& p : list) {
+                double tf = p.tf;
+                double norm = params_.k1 * (1.0 - params_.b + params_.b * docs_[p.doc].length / avg_len);
+                touch(p.doc, idf * tf * (params_.k1 + 1.0) / (tf + norm));
+            }
+        });
+
+        // 2. Embedding 相似度 (库在千级规模，直接在量化编码上扫描)
+        if (embeddings && query) {
+            for (uint32_t slot = 0; slot < docs_.size(); ++slot) {
+                const Doc& d = docs_[slot];
+                if (!d.live || d.embedding_row == NO_EMBEDDING) continue;
+                double cos = embeddings->score(*query, d.embedding_row);
+                if (cos > 0.0) touch(slot, params_.embedding_weight * cos);
+            }
+        }
+
+        // 3. 先验加权 + top-k 最小堆
+        using Scored = std::pair<double, int>;
+        std::vector<Scored> heap;
+        heap.reserve(k + 1);
+        auto cmp = std::greater<Scored>();
+        for (uint32_t slot : sc.touched) {
+            double s = sc.acc[slot] * docs_[slot].prior;
+            sc.acc[slot] = 0.0;
+            if (s <= min_score) continue;
+            if (heap.size() < k) {
+                heap.emplace_back(s, docs_[slot].id);
+                std::push_heap(heap.begin(), heap.end(), cmp);
+            } else if (s > heap.front().first) {
+                std::pop_heap(heap.begin(), heap.end(), cmp);
+                heap.back() = {s, docs_[slot].id};
+                std::push_heap(heap.begin(), heap.end(), cmp);
+            }
+        }
+        std::sort(heap.begin(), heap.end(), cmp);
+
+        std::vector<Hit> out;
+        out.reserve(heap.size());
+        for (const auto& [s, id] : heap) out.push_back({id, s});
+        return out;
+    }
+};
+
+} // namespace titan::learning
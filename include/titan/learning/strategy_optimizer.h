@@ -1,11 +1,21 @@
 #pragma once
 #include "titan/memory/cognitive_stream.h"
+#include "titan/memory/quantized_store.h"
+#include "titan/learning/strategy_index.h"
+#include "titan/learning/strategy_store.h"
 #include "nlohmann_json/json.hpp"
+#include <iostream>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <sstream>
 #include <algorithm>
 #include <map>
+#include <unordered_map>
 #include <cmath>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 
 namespace titan::learning {
 
@@ -14,99 +24,298 @@ struct StrategyEntry {
     std::string rule_text;      // "If user shouts, stop immediately."
     std::vector<std::string> tags; // ["safety", "audio", "urgent"]
     
-    // 模拟 Embedding 向量
-    std::vector<float> embedding; 
+    // Embedding 在 StrategyOptimizer 的量化存储中的行号 (NO_EMBEDDING = 没有向量)
+    static constexpr uint32_t NO_EMBEDDING = titan::memory::QuantizedStore::NPOS;
+    uint32_t embedding_row = NO_EMBEDDING;
     
     int usage_count = 0;        // 使用频率
     double success_rate = 1.0;  // 成功率
 };
 using json = nlohmann::json;
 
+// 一次对策略库的修改 (已解析好的结构，不再经过 JSON)
+struct StrategyUpdate {
+    StrategyOp op = StrategyOp::ADD;
+    int target_id = 0;               // MODIFY / DELETE
+    std::string rule_text;
+    std::vector<std::string> tags;
+    std::vector<float> embedding;    // 可选；MODIFY 时为空表示保留原向量
+};
+
+// 线程模型: 检索 (规划线程) 与构建反思 Prompt 持读锁，可以并发；
+// 修改内存状态并备好要落盘的记录时持写锁，落盘 (fdatasync / 压缩) 只持 store_mtx_，读者从不等磁盘。
+// 写操作只来自反思，频率很低。
 class StrategyOptimizer {
 private:
+    mutable std::shared_mutex mtx_;
+    std::mutex store_mtx_;   // 串行化落盘；在释放 mtx_ 之前取得，日志顺序与内存修改顺序一致
+
     std::vector<StrategyEntry> strategy_db_;
     int next_id_ = 1;
 
-    // 模拟：计算两个文本的相似度 (实际应使用 BERT/CLIP/OpenAI Embedding)
-    double calculateSimilarity(const std::string& query, const StrategyEntry& entry) {
-        // 简化的关键词匹配模拟
-        double score = 0.0;
-        for (const auto& tag : entry.tags) {
-            if (query.find(tag) != std::string::npos) score += 0.5;
+    // 所有策略的 Embedding 集中量化存放: MODIFY 原地覆盖，DELETE 释放的行留给之后的 ADD 复用，
+    // 行数不超过同时存活的带向量策略数的峰值 (与编辑历史无关)
+    titan::memory::QuantizedStore embeddings_;
+    std::vector<uint32_t> free_rows_;
+
+    // row 为策略现有的行 (NO_EMBEDDING = 还没有)，返回写入后的行号
+    uint32_t storeEmbedding(const std::vector<float>& embedding, uint32_t row = StrategyEntry::NO_EMBEDDING) {
+        if (embedding.empty()) return row;
+        if (row != StrategyEntry::NO_EMBEDDING) {
+            embeddings_.set(row, embedding);   // 维度不一致时保留原向量
+            return row;
+        }
+        if (!free_rows_.empty() && embeddings_.set(free_rows_.back(), embedding)) {
+            row = free_rows_.back();
+            free_rows_.pop_back();
+            return row;
+        }
+        return embeddings_.add(embedding);
+    }
+
+    void releaseEmbedding(uint32_t row) {
+        if (row != StrategyEntry::NO_EMBEDDING) free_rows_.push_back(row);
+    }
+
+    // 持久化 (attachStore 之前为纯内存模式)
+    std::unique_ptr<StrategyStore> store_;
+
+    // 检索索引: 标签/规则文本的倒排表 (BM25) + Embedding 相似度，随 ADD/MODIFY 增量维护
+    StrategyIndex index_;
+
+    static constexpr size_t RETRIEVE_TOP_K = 3;
+    static constexpr double RETRIEVE_MIN_SCORE = 0.1;
+
+    // 经常成功使用的策略加分
+    static double priorOf(const StrategyEntry& entry) { return 1.0 + entry.usage_count * 0.1; }
+
+    void reindex(const StrategyEntry& entry) {
+        index_.upsert(entry.id, entry.rule_text, entry.tags, entry.embedding_row, priorOf(entry));
+    }
+
+    std::unordered_map<int, size_t> slot_of_;   // 策略 ID -> strategy_db_ 下标
+
+    const StrategyEntry* findEntry(int id) const {
+        auto it = slot_of_.find(id);
+        return it != slot_of_.end() ? &strategy_db_[it->second] : nullptr;
+    }
+    StrategyEntry* findEntry(int id) {
+        auto it = slot_of_.find(id);
+        return it != slot_of_.end() ? &strategy_db_[it->second] : nullptr;
+    }
+
+    void insertEntry(StrategyEntry&& entry) {
+        slot_of_[entry.id] = strategy_db_.size();
+        strategy_db_.push_back(std::move(entry));
+        reindex(strategy_db_.back());
+    }
+
+    // 与末尾元素交换后弹出，保持 strategy_db_ 连续
+    void eraseEntry(int id) {
+        auto it = slot_of_.find(id);
+        if (it == slot_of_.end()) return;
+        size_t slot = it->second;
+        slot_of_.erase(it);
+        index_.remove(id);
+        releaseEmbedding(strategy_db_[slot].embedding_row);
+        if (slot + 1 != strategy_db_.size()) {
+            strategy_db_[slot] = std::move(strategy_db_.back());
+            slot_of_[strategy_db_[slot].id] = slot;
+        }
+        strategy_db_.pop_back();
+    }
+
+    StrategyRecord toRecord(const StrategyEntry& entry, bool with_embedding) const {
+        StrategyRecord rec;
+        rec.id = entry.id;
+        rec.rule_text = entry.rule_text;
+        rec.tags = entry.tags;
+        rec.usage_count = entry.usage_count;
+        rec.success_rate = entry.success_rate;
+        if (with_embedding && entry.embedding_row != StrategyEntry::NO_EMBEDDING) {
+            // 量化存储只保留编码，这里写回的是解码值 (INT8 下重新量化基本不变)
+            std::vector<float> buf(embeddings_.stride());
+            embeddings_.decode(entry.embedding_row, buf.data());
+            rec.embedding.assign(buf.begin(), buf.begin() + embeddings_.dim());
         }
-        return score;
+        return rec;
+    }
+
+    // 调用方持有 mtx_ 写锁 (lock)；这里换成 store_mtx_ 后释放写锁，再做磁盘 I/O
+    void persist(std::unique_lock<std::shared_mutex>& lock, StrategyOp op, StrategyRecord&& rec) {
+        if (!store_) return;
+        StrategyStore* store = store_.get();
+        int next_id = next_id_;
+        std::lock_guard<std::mutex> store_lock(store_mtx_);
+        std::vector<StrategyRecord> all;
+        bool compact = store->needsCompactionAfterAppend();
+        if (compact) {
+            all.reserve(strategy_db_.size());
+            for (const auto& entry : strategy_db_) all.push_back(toRecord(entry, true));
+        }
+        lock.unlock();
+
+        store->append(op, rec, next_id);
+        if (compact) store->compact(all, next_id);
     }
 
 public:
     // --- 1. RAG 检索接口 ---
     // 根据当前的任务描述和最近的事件流，检索最相关的 K 条策略
-    std::string retrieveRelevantStrategies(const std::string& task_desc, const std::string& recent_stream_summary) {
+    // query_embedding: 可选，任务描述的 Embedding (与策略 Embedding 同一模型)
+    // used_ids: 可选，追加写入进入 Prompt 的策略 ID (任务结束后据此 recordOutcome)
+    std::string retrieveRelevantStrategies(std::string_view task_desc, std::string_view recent_stream_summary,
+                                           const std::vector<float>* query_embedding = nullptr,
+                                           std::vector<int>* used_ids = nullptr) const {
+        std::shared_lock<std::shared_mutex> lock(mtx_);
         if (strategy_db_.empty()) return "";
 
-        std::string query_context = task_desc + " " + recent_stream_summary;
-        
-        // 简单的打分排序
-        std::vector<std::pair<double, int>> scores;
-        for (int i = 0; i < strategy_db_.size(); ++i) {
-            double sim = calculateSimilarity(query_context, strategy_db_[i]);
-            // 经常成功使用的策略加分
-            double weight = 1.0 + (strategy_db_[i].usage_count * 0.1); 
-            scores.push_back({sim * weight, i});
+        std::string query_context;
+        query_context.reserve(task_desc.size() + 1 + recent_stream_summary.size());
+        query_context.append(task_desc).append(" ").append(recent_stream_summary);
+
+        thread_local titan::memory::QuantizedStore::Query query_buf;   // 查询向量的预处理结果 (复用)
+        const titan::memory::QuantizedStore::Query* q = nullptr;
+        if (query_embedding && embeddings_.size() > 0 && embeddings_.prepare(*query_embedding, query_buf)) {
+            q = &query_buf;
         }
 
-        // Top-K 排序
-        std::sort(scores.rbegin(), scores.rend());
+        // 只遍历查询词命中的倒排表，再用 top-k 小顶堆取前 3 条 (阈值过滤)
+        auto hits = index_.search(query_context, RETRIEVE_TOP_K, RETRIEVE_MIN_SCORE, q ? &embeddings_ : nullptr, q);
 
         std::stringstream ss;
         ss << "### Relevant Strategies (Retrieved) ###\n";
-        int k = std::min((int)strategy_db_.size(), 3); // 只取前 3 条
-        for (int i = 0; i < k; ++i) {
-            const auto& entry = strategy_db_[scores[i].second];
-            if (scores[i].first > 0.1) { // 阈值过滤
-                ss << "- " << entry.rule_text << "\n";
+        for (const auto& hit : hits) {
+            if (const StrategyEntry* entry = findEntry(hit.id)) {
+                ss << "- " << entry->rule_text << "\n";
+                if (used_ids && std::find(used_ids->begin(), used_ids->end(), hit.id) == used_ids->end()) {
+                    used_ids->push_back(hit.id);
+                }
             }
         }
         return ss.str();
     }
 
     // --- 2. 学习与更新接口 ---
-    // 在复盘时调用，LLM 返回建议，这里负责合并
+    // 打开持久化目录并加载已学到的策略 (快照 + 操作日志)，之后的每次修改都会落盘
+    bool attachStore(const StrategyStore::Options& opts) {
+        auto store = std::make_unique<StrategyStore>(opts);
+        if (!store->isOpen()) return false;
+
+        auto loaded = store->load();
+        std::unique_lock<std::shared_mutex> lock(mtx_);
+        strategy_db_.clear();
+        slot_of_.clear();
+        index_ = StrategyIndex();
+        embeddings_ = titan::memory::QuantizedStore();
+        free_rows_.clear();
+        strategy_db_.reserve(loaded.records.size());
+        for (auto& rec : loaded.records) {
+            StrategyEntry entry;
+            entry.id = rec.id;
+            entry.rule_text = std::move(rec.rule_text);
+            entry.tags = std::move(rec.tags);
+            entry.embedding_row = storeEmbedding(rec.embedding);
+            entry.usage_count = rec.usage_count;
+            entry.success_rate = rec.success_rate;
+            insertEntry(std::move(entry));
+        }
+        next_id_ = loaded.next_id;
+        std::lock_guard<std::mutex> store_lock(store_mtx_);
+        store_ = std::move(store);
+        std::cout << "[Strategy] Loaded " << strategy_db_.size() << " rules from " << opts.dir
+                  << " (" << loaded.replayed_ops << " ops replayed)" << std::endl;
+        return true;
+    }
+
+    // 应用一次修改，返回是否生效
+    bool applyUpdate(StrategyUpdate update) {
+        std::unique_lock<std::shared_mutex> lock(mtx_);
+        switch (update.op) {
+            case StrategyOp::ADD: {
+                StrategyEntry entry;
+                entry.id = next_id_++;
+                entry.rule_text = std::move(update.rule_text);
+                entry.tags = std::move(update.tags);
+                entry.embedding_row = storeEmbedding(update.embedding);
+                std::cout << "[Strategy] Added new rule: " << entry.rule_text << std::endl;
+                StrategyRecord rec = toRecord(entry, false);
+                rec.embedding = std::move(update.embedding);
+                insertEntry(std::move(entry));
+                persist(lock, StrategyOp::ADD, std::move(rec));
+                return true;
+            }
+            case StrategyOp::MODIFY: {
+                StrategyEntry* entry = findEntry(update.target_id);
+                if (!entry) return false;
+                std::cout << "[Strategy] Updated rule " << update.target_id << ": " << entry->rule_text << " -> "
+                          << update.rule_text << std::endl;
+                entry->rule_text = std::move(update.rule_text);
+                entry->tags = std::move(update.tags);
+                entry->embedding_row = storeEmbedding(update.embedding, entry->embedding_row);
+                reindex(*entry);
+                StrategyRecord rec = toRecord(*entry, false);
+                rec.embedding = std::move(update.embedding);
+                persist(lock, StrategyOp::MODIFY, std::move(rec));
+                return true;
+            }
+            case StrategyOp::DELETE: {
+                if (!findEntry(update.target_id)) return false;
+                std::cout << "[Strategy] Deleted rule " << update.target_id << std::endl;
+                eraseEntry(update.target_id);
+                StrategyRecord rec;
+                rec.id = update.target_id;
+                persist(lock, StrategyOp::DELETE, std::move(rec));
+                return true;
+            }
+            case StrategyOp::STATS:
+                break;
+        }
+        return false;
+    }
+
+    // 规划中使用了某条策略的任务结束后回报结果 (更新使用次数、成功率和检索先验)；
+    // 由 ReflectionWorker 在复盘之后调用
+    void recordOutcome(int id, bool success) {
+        std::unique_lock<std::shared_mutex> lock(mtx_);
+        StrategyEntry* entry = findEntry(id);
+        if (!entry) return;
+        ++entry->usage_count;
+        entry->success_rate += ((success ? 1.0 : 0.0) - entry->success_rate) / entry->usage_count;
+        index_.setPrior(id, priorOf(*entry));
+        persist(lock, StrategyOp::STATS, toRecord(*entry, false));
+    }
+
+    // 在复盘时调用，LLM 返回建议，这里负责解析后交给 applyUpdate
     void updateStrategyLibrary(const std::string& llm_suggestion_json) {
         // 假设 LLM 返回的格式是:
         // {
         //    "action": "ADD" | "MODIFY" | "DELETE",
         //    "target_id": 12 (if MODIFY/DELETE),
         //    "new_rule": "...",
-        //    "tags": ["..."]
+        //    "tags": ["..."],
+        //    "embedding": [...] (可选，由上层 Embedding 模型填入)
         // }
         
         try {
             auto j = json::parse(llm_suggestion_json);
             std::string action = j["action"];
 
-            if (action == "ADD") {
-                StrategyEntry entry;
-                entry.id = next_id_++;
-                entry.rule_text = j["new_rule"];
-                entry.tags = j["tags"].get<std::vector<std::string>>();
-                // entry.embedding = compute_embedding(entry.rule_text); 
-                strategy_db_.push_back(entry);
-                std::cout << "[Strategy] Added new rule: " << entry.rule_text << std::endl;
-            } 
-            else if (action == "MODIFY") {
-                int target_id = j["target_id"];
-                for (auto& entry : strategy_db_) {
-                    if (entry.id == target_id) {
-                        std::cout << "[Strategy] Updated rule " << target_id << ": " << entry.rule_text << " -> " << j["new_rule"] << std::endl;
-                        entry.rule_text = j["new_rule"];
-                        entry.tags = j["tags"].get<std::vector<std::string>>();
-                        break;
-                    }
+            StrategyUpdate update;
+            if (action == "ADD") update.op = StrategyOp::ADD;
+            else if (action == "MODIFY") update.op = StrategyOp::MODIFY;
+            else if (action == "DELETE") update.op = StrategyOp::DELETE;
+            else return;   // NONE
+
+            if (update.op != StrategyOp::ADD) update.target_id = j["target_id"];
+            if (update.op != StrategyOp::DELETE) {
+                update.rule_text = j["new_rule"];
+                update.tags = j["tags"].get<std::vector<std::string>>();
+                if (j.contains("embedding") && j["embedding"].is_array()) {
+                    update.embedding = j["embedding"].get<std::vector<float>>();
                 }
             }
-            else if (action == "DELETE") {
-                // ... remove logic ...
-            }
+            applyUpdate(std::move(update));
         } catch (...) {
             std::cerr << "[Strategy] Failed to parse LLM suggestion." << std::endl;
         }
@@ -115,23 +324,33 @@ public:
     // --- 3. 反思流程 (System 2) ---
     void reflectOnEpisode(const std::vector<titan::core::CognitiveEvent>& history, bool success) {
         // 1. 将历史转为文本
-        std::stringstream log_ss;
-        for(const auto& evt : history) log_ss << evt.toString() << "\n";
+        std::string transcript;
+        for(const auto& evt : history) {
+            transcript += evt.toString();
+            transcript += '\n';
+        }
+        reflectOnTranscript(transcript, success);
+    }
 
+    // transcript: 每行一条事件，格式同 CognitiveEvent::toString() (ReflectionWorker 从日志流式拼出)
+    void reflectOnTranscript(std::string_view transcript, bool success) {
         // 2. 将当前已有的策略列表传给 LLM (带 ID，方便它引用)
         std::stringstream existing_rules_ss;
-        for(const auto& s : strategy_db_) {
-            existing_rules_ss << "ID " << s.id << ": " << s.rule_text << "\n";
+        {
+            std::shared_lock<std::shared_mutex> lock(mtx_);
+            for(const auto& s : strategy_db_) {
+                existing_rules_ss << "ID " << s.id << ": " << s.rule_text << "\n";
+            }
         }
 
         // 3. 构建 Prompt
         std::stringstream prompt;
         prompt << "Analyze the interaction log below.\n";
         prompt << "Outcome: " << (success ? "SUCCESS" : "FAILURE") << "\n";
-        prompt << "Log:\n" << log_ss.str() << "\n\n";
+        prompt << "Log:\n" << transcript << "\n\n";
         prompt << "Existing Strategies:\n" << existing_rules_ss.str() << "\n";
-        prompt << "Task: Do we need to ADD a new strategy, MODIFY an existing one, or do NOTHING?\n";
-        prompt << "Output JSON format: { \"action\": \"ADD/MODIFY/NONE\", \"target_id\": <id>, \"new_rule\": \"...\", \"tags\": [...] }";
+        prompt << "Task: Do we need to ADD a new strategy, MODIFY or DELETE an existing one, or do NOTHING?\n";
+        prompt << "Output JSON format: { \"action\": \"ADD/MODIFY/DELETE/NONE\", \"target_id\": <id>, \"new_rule\": \"...\", \"tags\": [...] }";
 
         // 4. 调用 LLM (Mock)
         // std::string response = call_llm(prompt.str());
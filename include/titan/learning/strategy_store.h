@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace titan::learning {
+
+// 落盘的一条策略 (Embedding 以 fp32 保存，加载后重新量化)
+struct StrategyRecord {
+    int id = 0;
+    std::string rule_text;
+    std::vector<std::string> tags;
+    std::vector<float> embedding;   // 空 = 没有向量
+    int usage_count = 0;
+    double success_rate = 1.0;
+};
+
+enum class StrategyOp : uint8_t {
+    ADD = 1,
+    MODIFY = 2,   // 整条替换 (embedding 为空时保留原向量)
+    DELETE = 3,   // 只用到 id
+    STATS = 4     // 只更新 usage_count / success_rate
+};
+
+// 策略库的持久化存储
+//
+// 目录布局:  <dir>/strategies.snap   压缩快照 (全部存活策略 + next_id)
+//            <dir>/strategies.log    快照之后的操作日志 (只追加，每条带序号和校验和)
+// 启动: mmap 快照按二进制记录直接解码，再重放日志中序号大于快照的操作；全程不解析 JSON。
+// 压缩: 日志条数达到 compact_every 后由调用方提供当前全量状态写新快照 (临时文件 + rename)，
+//       再截断日志。两步之间崩溃也安全: 重放时会跳过快照已包含的序号。
+//
+// 线程模型: 单写者 (调用方负责串行化)。
+class StrategyStore {
+public:
+    struct Options {
+        std::string dir = "strategies";
+        size_t compact_every = 256;   // 日志累积多少条后建议压缩
+        bool sync = true;             // 每条日志 / 快照写完后 fdatasync
+    };
+
+    struct LoadResult {
+        std::vector<StrategyRecord> records;   // 按 id 升序
+        int next_id = 1;
+        size_t replayed_ops = 0;
+    };
+
+    explicit StrategyStore(const Options& opts);
+    ~StrategyStore();
+
+    StrategyStore(const StrategyStore&) = delete;
+    StrategyStore& operator=(const StrategyStore&) = delete;
+
+    bool isOpen() const { return ok_; }
+
+    // 启动时调用一次 (之后才能 append)
+    LoadResult load();
+
+    // 追加一条操作 (写入即落盘，sync = true 时保证掉电不丢)
+    void append(StrategyOp op, const StrategyRecord& rec, int next_id);
+
+    bool needsCompaction() const { return log_ops_ >= opts_.compact_every; }
+
+    // 再追加一条之后是否需要压缩 (调用方据此在修改内存状态的临界区里提前备好全量状态)
+    bool needsCompactionAfterAppend() const { return log_ops_ + 1 >= opts_.compact_every; }
+
+    // 用当前全量状态写快照并清空日志
+    bool compact(const std::vector<StrategyRecord>& records, int next_id);
+
+    uint64_t lastSeq() const { return last_seq_; }
+
+private:
+    Options opts_;
+    std::string snap_path_;
+    std::string log_path_;
+    bool ok_ = false;
+    int log_fd_ = -1;
+    uint64_t last_seq_ = 0;   // 最后写入 (或加载) 的操作序号
+    size_t log_ops_ = 0;      // 当前日志里的操作条数
+    std::vector<uint8_t> buffer_;
+
+    bool openLog(bool truncate);
+    bool writeAll(int fd, const void* data, size_t len);
+};
+
+} // namespace titan::learning
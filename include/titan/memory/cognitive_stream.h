@@ -1,102 +1,658 @@
 #pragma once
 #include "titan/core/types.h"
-#include <deque>
+#include "titan/core/ring_buffer.h"
+#include "stream_storage.h"
+#include "stream_summary.h"
+#include "episode_log.h"
+#include <optional>
 #include <vector>
-#include <sstream>
+#include <string_view>
+#include <algorithm>
 #include "nlohmann_json/json.hpp"
 
 namespace titan::memory {
 
 using json = nlohmann::json;
 
+// 环中的紧凑事件记录
+// 摘要 = 驻留前缀 (prefix) + Arena 中的正文；明细是紧跟正文的二进制记录。
+struct StreamRecord {
+    titan::core::TimePoint timestamp;
+    titan::core::EventType type = titan::core::EventType::THOUGHT_CHAIN;
+    PhraseId prefix = NO_PHRASE;
+    uint32_t block_offset = 0;   // Arena 中 [正文][明细] 连续块的起点
+    uint32_t text_len = 0;
+    uint32_t detail_len = 0;
+    uint32_t line_len = 0;       // 该事件在渲染缓存中的行长度 (含换行)
+    uint32_t repeat = 1;         // 连续相同 / 同类事件合并后的计数
+};
+
+// 视觉变化检测的最小单元
+// 按实体追踪时 key = track_id；只有检测框时 key = 类别短语 ID，count 为同类数量。
+struct VisibleItem {
+    int key = 0;
+    PhraseId label = NO_PHRASE;
+    uint16_t count = 1;
+    bool moving = false;
+
+    bool sameState(const VisibleItem& o) const { return count == o.count && moving == o.moving; }
+};
+
 class CognitiveStream {
+public:
+    static constexpr size_t DEFAULT_MAX_HISTORY = 100;
+    static constexpr size_t DEFAULT_ARENA_BYTES = 64 * 1024;
+    static constexpr std::string_view PROMPT_HEADER = "### Recent Stream of Consciousness ###\n";
+    static constexpr std::string_view SUMMARY_HEADER = "### Earlier (Summarized) ###\n";
+
 private:
-    std::deque<titan::core::CognitiveEvent> stream_;
-    const size_t MAX_HISTORY = 100;
-    
+    // 定长事件环 + FIFO 字节池：槽位与正文空间都在构造时分配好，稳态下不再分配
+    titan::core::FixedRing<StreamRecord> ring_;
+    EventArena arena_;
+    PhraseTable phrases_;
+
+    // 热路径复用的临时缓冲 (只增长到峰值一次)
+    std::string text_scratch_;
+    std::vector<uint8_t> detail_scratch_;
+
+    // 增量渲染缓存，布局: [已淘汰的死区][PROMPT_HEADER][行0][行1]...
+    // 新事件只在尾部追加一行；淘汰最旧事件时把表头往后挪一行的距离，
+    // 死区超过一半时整体前移一次 (摊还 O(1))。
+    std::string rendered_;
+    size_t render_start_ = 0;  // 表头在 rendered_ 中的起点
+
+    // 被挤出窗口的事件折叠成分钟/小时摘要，而不是直接丢弃
+    StreamSummarizer summarizer_;
+    std::string fold_scratch_;
+
+    // 追加式事件日志 (可选)：窗口只保留最近事件，完整的 episode 落盘后按需回放
+    EpisodeLog* episode_log_ = nullptr;
+    std::vector<uint8_t> log_scratch_;
+    titan::core::TimePoint episode_start_{};
+
+    // Token 预算 (0 = 不限)；预算内的 Prompt 按 revision 缓存
+    // 布局: [PROMPT_HEADER][最近事件行][摘要区]。最近事件区只追加，起点只在超预算或被淘汰时整段前移；
+    // 摘要区单独缓存，只在摘要层或被省略的事件变化时重建，每次只拷贝到尾部。
+    size_t token_budget_ = 0;
+    uint64_t revision_ = 0;
+    uint64_t prompt_revision_ = UINT64_MAX;
+    std::string prompt_cache_;
+    uint64_t evicted_ = 0;              // 已淘汰的事件数: ring_[i] 的全局序号 = evicted_ + i
+    bool prompt_valid_ = false;
+    uint64_t prompt_first_ = 0;         // 最近事件区覆盖的全局序号 [prompt_first_, prompt_next_)
+    uint64_t prompt_next_ = 0;
+    size_t prompt_recent_end_ = 0;      // 最近事件区在 prompt_cache_ 中的终点
+    uint32_t prompt_last_len_ = 0;      // 最后一行的长度与合并计数 (重复事件会改写最后一行)
+    uint32_t prompt_last_repeat_ = 0;
+    std::string summary_cache_;
+    uint64_t summary_key_[3] = {UINT64_MAX, 0, 0};   // {摘要层 revision, evicted_, prompt_first_}
+
+    // 常用短语 / JSON key 预驻留
+    PhraseId phrase_saw_objects_, phrase_scene_change_;
+    PhraseId phrase_vision_blurry_, phrase_vision_dark_, phrase_vision_normal_;
+    PhraseId phrase_arm_stalled_, phrase_arm_active_, phrase_arm_idle_;
+    PhraseId key_quality_, key_label_;
+    PhraseId key_id_, key_count_, key_moving_, key_appeared_, key_gone_, key_changed_;
+
     // 用于状态去重，防止连续记录 "Vision is blurry"
     titan::core::FrameQuality last_visual_quality_ = titan::core::FrameQuality::VALID;
     titan::core::ComponentState last_arm_state_ = titan::core::ComponentState::READY;
 
+    // 视觉事件的变化检测与限流
+    // 只与"上一次发出的快照"做集合差分；限流窗口内的出现又消失会被自然抵消。
+    std::vector<VisibleItem> emitted_items_;   // 上一次发出事件时的可见集合 (按 key 排序)
+    std::vector<VisibleItem> current_items_;   // 本帧可见集合 (复用缓冲)
+    bool emitted_by_id_ = false;
+    titan::core::TimePoint last_visual_emit_{};
+    titan::core::TimePoint last_keyframe_;       // 上一次描述场景的时刻 (变化差分或全量快照)
+    double visual_min_interval_ = 1.0;         // 两次视觉事件的最小间隔 (s)
+    double visual_keyframe_interval_ = 30.0;   // 场景不变时补发全量快照的间隔 (s)，0 = 关闭
+    double merge_window_ = 10.0;               // 同类视觉事件合并的时间窗 (从一串的第一条算起，s)
+    static constexpr double MOVING_SPEED = 0.05;  // m/s，超过视为运动中
+    static constexpr int MIN_ENTITY_AGE = 3;      // 实体至少存活 3 帧才算"确认"，过滤闪烁
+
+    void renderLine(StreamRecord& rec) {
+        size_t before = rendered_.size();
+        rendered_ += titan::core::eventTypeTag(rec.type);
+        rendered_ += ' ';
+        rendered_ += phrases_.view(rec.prefix);
+        rendered_ += recordText(rec);
+        if (rec.repeat > 1) {
+            rendered_ += " (x";
+            rendered_ += std::to_string(rec.repeat);
+            rendered_ += ')';
+        }
+        rendered_ += '\n';
+        rec.line_len = static_cast<uint32_t>(rendered_.size() - before);
+    }
+
+    void evictOldest() {
+        const StreamRecord& oldest = ring_.front();
+        fold_scratch_.assign(phrases_.view(oldest.prefix));
+        fold_scratch_ += recordText(oldest);
+        summarizer_.fold(oldest.timestamp, oldest.type, oldest.repeat, fold_scratch_);
+        ++revision_;
+
+        size_t line = oldest.line_len;
+        std::memmove(&rendered_[render_start_ + line], &rendered_[render_start_], PROMPT_HEADER.size());
+        render_start_ += line;
+        if (render_start_ > rendered_.size() / 2) {
+            rendered_.erase(0, render_start_);
+            render_start_ = 0;
+        }
+
+        ring_.pop_front();
+        ++evicted_;
+        if (ring_.empty()) arena_.reset();
+        else arena_.releaseUntil(ring_.front().block_offset);
+    }
+
+    // 同类事件: 正文每次都不同，但连续出现时只需要最新的一条 (视觉快照 / 场景变化属于同一类)
+    bool isVisualState(titan::core::EventType type, PhraseId prefix) const {
+        return type == titan::core::EventType::PERCEPTION_VISUAL &&
+               (prefix == phrase_saw_objects_ || prefix == phrase_scene_change_);
+    }
+
+    // 这条事件写入时是否会并入最新一条 (同类且在 merge_window_ 内，窗口从这一串的第一条算起)
+    bool mergesWithNewest(titan::core::EventType type, PhraseId prefix, titan::core::TimePoint now) const {
+        if (ring_.empty() || !isVisualState(type, prefix)) return false;
+        const StreamRecord& last = ring_.back();
+        return isVisualState(last.type, last.prefix) &&
+               std::chrono::duration<double>(now - last.timestamp).count() < merge_window_;
+    }
+
+    // 撤销最新一条事件 (它的块一定在 Arena 的写入端)
+    void dropNewest() {
+        rendered_.resize(rendered_.size() - ring_.back().line_len);
+        uint32_t off = ring_.back().block_offset;
+        ring_.pop_back();
+        if (ring_.empty()) arena_.reset();
+        else arena_.rewindTo(off);
+    }
+
+    // 所有事件的唯一写入口
+    void appendRecord(titan::core::EventType type, PhraseId prefix,
+                      std::string_view text, const std::vector<uint8_t>& detail) {
+        const auto now = std::chrono::steady_clock::now();
+        static const uint8_t NIL_DETAIL = static_cast<uint8_t>(DetailTag::NIL);
+
+        // 日志记录每一次发生 (不做合并/截断)，明细中的短语展开为内联字符串
+        if (episode_log_) {
+            if (detail.empty()) log_scratch_.assign(1, NIL_DETAIL);
+            else inlinePhrases(detail.data(), detail.size(), phrases_, log_scratch_);
+            episode_log_->append(type, now, phrases_.view(prefix), text, log_scratch_.data(), log_scratch_.size());
+        }
+
+        // 与上一条完全相同 (类型 + 摘要) 时只累加计数，明细保留首次出现的那份；
+        // 同类事件在 merge_window_ 内则替换为最新的正文和明细，同样累加计数，时间戳保留这一串的起点
+        uint32_t repeat = 1;
+        titan::core::TimePoint timestamp = now;
+        if (!ring_.empty()) {
+            StreamRecord& last = ring_.back();
+            if (last.type == type && last.prefix == prefix && recordText(last) == text) {
+                rendered_.resize(rendered_.size() - last.line_len);
+                ++last.repeat;
+                renderLine(last);
+                ++revision_;
+                return;
+            }
+            if (mergesWithNewest(type, prefix, now)) {
+                repeat = last.repeat + 1;
+                timestamp = last.timestamp;
+                dropNewest();
+            }
+        }
+
+        const uint8_t* detail_ptr = detail.empty() ? &NIL_DETAIL : detail.data();
+        size_t detail_len = detail.empty() ? 1 : detail.size();
+
+        // 超大事件：先丢明细，再截断正文，保证单个事件不超过 Arena 容量
+        if (detail_len + text.size() > arena_.capacity()) {
+            detail_ptr = &NIL_DETAIL;
+            detail_len = 1;
+            if (text.size() + detail_len > arena_.capacity()) {
+                text = text.substr(0, arena_.capacity() - detail_len);
+            }
+        }
+
+        if (ring_.full()) evictOldest();
+        std::optional<uint32_t> off;
+        while (!(off = arena_.allocate(text.size() + detail_len))) evictOldest();
+
+        char* dst = arena_.data(*off);
+        if (!text.empty()) std::memcpy(dst, text.data(), text.size());
+        std::memcpy(dst + text.size(), detail_ptr, detail_len);
+
+        StreamRecord& rec = ring_.push_back();
+        rec.timestamp = timestamp;
+        rec.type = type;
+        rec.prefix = prefix;
+        rec.block_offset = *off;
+        rec.text_len = static_cast<uint32_t>(text.size());
+        rec.detail_len = static_cast<uint32_t>(detail_len);
+        rec.repeat = repeat;
+        renderLine(rec);
+        ++revision_;
+    }
+
+    std::string_view recordText(const StreamRecord& rec) const {
+        return {arena_.data(rec.block_offset), rec.text_len};
+    }
+
+    // ring_ 中第 i 条事件在 rendered_ 中的行 (各行在 rendered_ 尾部连续存放)
+    size_t lineOffset(size_t i) const {
+        size_t off = rendered_.size();
+        for (size_t k = ring_.size(); k > i; --k) off -= ring_[k - 1].line_len;
+        return off;
+    }
+
+    void rebuildRecentSection(size_t recent_budget, bool evicted) {
+        const size_t target = recent_budget == SIZE_MAX ? SIZE_MAX : recent_budget / 4 * 3;
+        size_t first = ring_.size();
+        size_t len = PROMPT_HEADER.size();
+        while (first > 0 && len + ring_[first - 1].line_len <= target) len += ring_[--first].line_len;
+        // 首行被淘汰时多跳过 1/4 窗口，接下来的淘汰不会马上再次改写前缀
+        if (evicted) first = std::max(first, std::min(ring_.size() / 4, ring_.size() - 1));
+        if (ring_.empty()) first = 0;
+
+        prompt_cache_.assign(PROMPT_HEADER);
+        prompt_cache_ += std::string_view(rendered_).substr(lineOffset(first));
+        prompt_first_ = evicted_ + first;
+        prompt_next_ = evicted_ + ring_.size();
+        prompt_recent_end_ = prompt_cache_.size();
+        prompt_last_len_ = ring_.empty() ? 0 : ring_.back().line_len;
+        prompt_last_repeat_ = ring_.empty() ? 0 : ring_.back().repeat;
+        prompt_valid_ = true;
+    }
+
+    // 把新事件追加到最近事件区；只有超预算或首行已被淘汰时才整段重建
+    void syncRecentSection(size_t recent_budget) {
+        if (!prompt_valid_ || prompt_first_ < evicted_) {
+            rebuildRecentSection(recent_budget, prompt_valid_);
+            return;
+        }
+        prompt_cache_.resize(prompt_recent_end_);
+
+        // 最后一行在上次渲染后被合并计数改写 (之后可能又追加了新事件): 去掉旧行重新追加
+        if (prompt_next_ > prompt_first_ &&
+            ring_[static_cast<size_t>(prompt_next_ - 1 - evicted_)].repeat != prompt_last_repeat_) {
+            prompt_cache_.resize(prompt_cache_.size() - prompt_last_len_);
+            --prompt_next_;
+        }
+
+        const size_t from = static_cast<size_t>(prompt_next_ - evicted_);
+        if (from < ring_.size()) {
+            prompt_cache_ += std::string_view(rendered_).substr(lineOffset(from));
+            prompt_next_ = evicted_ + ring_.size();
+            prompt_last_len_ = ring_.back().line_len;
+            prompt_last_repeat_ = ring_.back().repeat;
+        }
+        prompt_recent_end_ = prompt_cache_.size();
+        if (prompt_recent_end_ > recent_budget) rebuildRecentSection(recent_budget, false);
+    }
+
+    // 摘要区: 摘要层 + 窗口内未进入最近事件区的事件统计，只在两者变化时重建
+    void syncSummarySection(size_t max_chars) {
+        const uint64_t key[3] = {summarizer_.revision(), evicted_, prompt_first_};
+        if (std::equal(key, key + 3, summary_key_)) return;
+        std::copy(key, key + 3, summary_key_);
+        summary_cache_.clear();
+
+        const size_t omitted_events = static_cast<size_t>(prompt_first_ - evicted_);
+        if (summarizer_.empty() && omitted_events == 0) return;
+
+        std::string omitted;
+        if (omitted_events > 0) {
+            std::array<uint32_t, TierSummary::EVENT_TYPE_COUNT> per_type{};
+            uint32_t total = 0;
+            for (size_t i = 0; i < omitted_events; ++i) {
+                per_type[static_cast<size_t>(ring_[i].type)] += ring_[i].repeat;
+                total += ring_[i].repeat;
+            }
+            omitted = "[... " + std::to_string(total) + " earlier events omitted:";
+            for (size_t t = 0; t < per_type.size(); ++t) {
+                if (per_type[t] == 0) continue;
+                omitted += " ";
+                omitted += titan::core::eventTypeTag(static_cast<titan::core::EventType>(t));
+                omitted += " x" + std::to_string(per_type[t]);
+            }
+            omitted += "]\n";
+        }
+
+        summary_cache_ += SUMMARY_HEADER;
+        size_t fixed = SUMMARY_HEADER.size() + omitted.size();
+        summarizer_.render(summary_cache_, max_chars > fixed ? max_chars - fixed : 0);
+        summary_cache_ += omitted;
+    }
+
+    void appendItemName(const VisibleItem& item, bool by_id) {
+        text_scratch_ += phrases_.view(item.label);
+        if (by_id) {
+            text_scratch_ += '#';
+            text_scratch_ += std::to_string(item.key);
+        } else if (item.count > 1) {
+            text_scratch_ += " x";
+            text_scratch_ += std::to_string(item.count);
+        }
+    }
+
+    void writeItem(DetailWriter& w, const VisibleItem& item, bool by_id) {
+        w.beginObject();
+        if (by_id) { w.key(key_id_); w.value(static_cast<int64_t>(item.key)); }
+        w.key(key_label_); w.phrase(item.label);
+        if (by_id) { w.key(key_moving_); w.value(item.moving); }
+        else { w.key(key_count_); w.value(static_cast<int64_t>(item.count)); }
+        w.endObject();
+    }
+
+    // 对 emitted_items_ 与 current_items_ 做有序集合差分，写出 appeared / gone / changed 三段。
+    // 返回是否有变化。
+    bool diffVisibleItems(bool by_id) {
+        text_scratch_.clear();
+        DetailWriter w(detail_scratch_);
+        w.beginObject();
+        bool any = false;
+
+        // kind: 0 = appeared, 1 = gone, 2 = changed
+        for (int kind = 0; kind < 3; ++kind) {
+            static const char* TITLES[] = {"Appeared: ", "Gone: ", "Changed: "};
+            const PhraseId keys[] = {key_appeared_, key_gone_, key_changed_};
+            bool section_open = false;
+            auto emit = [&](const VisibleItem& item) {
+                if (!section_open) {
+                    if (any) text_scratch_ += "; ";
+                    text_scratch_ += TITLES[kind];
+                    w.key(keys[kind]);
+                    w.beginArray();
+                    section_open = true;
+                } else {
+                    text_scratch_ += ", ";
+                }
+                appendItemName(item, by_id);
+                if (kind == 2 && by_id) text_scratch_ += item.moving ? " (moving)" : " (stopped)";
+                writeItem(w, item, by_id);
+                any = true;
+            };
+
+            size_t i = 0, j = 0;
+            while (i < emitted_items_.size() || j < current_items_.size()) {
+                if (j == current_items_.size() ||
+                    (i < emitted_items_.size() && emitted_items_[i].key < current_items_[j].key)) {
+                    if (kind == 1) emit(emitted_items_[i]);
+                    ++i;
+                } else if (i == emitted_items_.size() || current_items_[j].key < emitted_items_[i].key) {
+                    if (kind == 0) emit(current_items_[j]);
+                    ++j;
+                } else {
+                    if (kind == 2 && !current_items_[j].sameState(emitted_items_[i])) emit(current_items_[j]);
+                    ++i; ++j;
+                }
+            }
+            if (section_open) w.endArray();
+        }
+        w.endObject();
+        return any;
+    }
+
+    // 场景长时间不变时补发一次全量快照，避免事件窗口滚动后 LLM 不知道眼前有什么
+    void emitKeyframe(bool by_id) {
+        text_scratch_.clear();
+        DetailWriter w(detail_scratch_);
+        w.beginArray();
+        for (size_t i = 0; i < current_items_.size(); ++i) {
+            if (i > 0) text_scratch_ += ", ";
+            appendItemName(current_items_[i], by_id);
+            writeItem(w, current_items_[i], by_id);
+        }
+        w.endArray();
+        appendRecord(titan::core::EventType::PERCEPTION_VISUAL, phrase_saw_objects_, text_scratch_, detail_scratch_);
+    }
+
+    // 变化检测 + 限流的公共出口 (current_items_ 已按 key 排好序)
+    void emitVisualChanges(bool by_id) {
+        auto now = std::chrono::steady_clock::now();
+        // 识别方式切换 (检测框 <-> 实体) 时 key 空间不同，直接以当前集合为基准
+        if (by_id != emitted_by_id_) {
+            emitted_items_.clear();
+            emitted_by_id_ = by_id;
+        }
+        if (std::chrono::duration<double>(now - last_visual_emit_).count() < visual_min_interval_) return;
+
+        if (diffVisibleItems(by_id)) {
+            // 会并入上一条视觉事件时改发全量快照: 合并后的那一行总是完整描述当前场景，而不是只剩最后一次差分
+            if (!current_items_.empty() &&
+                mergesWithNewest(titan::core::EventType::PERCEPTION_VISUAL, phrase_scene_change_, now)) {
+                emitKeyframe(by_id);
+            } else {
+                appendRecord(titan::core::EventType::PERCEPTION_VISUAL, phrase_scene_change_, text_scratch_, detail_scratch_);
+            }
+            emitted_items_.assign(current_items_.begin(), current_items_.end());
+            last_visual_emit_ = now;
+            last_keyframe_ = now;   // 刚描述过变化，全量快照从这里重新计时
+        } else if (visual_keyframe_interval_ > 0.0 && !current_items_.empty() &&
+                   std::chrono::duration<double>(now - last_keyframe_).count() >= visual_keyframe_interval_) {
+            emitKeyframe(by_id);
+            last_keyframe_ = now;
+            last_visual_emit_ = now;
+        }
+    }
+
 public:
+    explicit CognitiveStream(size_t max_history = DEFAULT_MAX_HISTORY,
+                             size_t arena_bytes = DEFAULT_ARENA_BYTES)
+        : ring_(max_history), arena_(arena_bytes), last_keyframe_(std::chrono::steady_clock::now()) {
+        text_scratch_.reserve(256);
+        fold_scratch_.reserve(256);
+        log_scratch_.reserve(512);
+        detail_scratch_.reserve(512);
+        rendered_.reserve(2 * (PROMPT_HEADER.size() + max_history * 96));
+        rendered_.assign(PROMPT_HEADER);
+
+        phrase_saw_objects_   = phrases_.intern("Saw objects: ");
+        phrase_scene_change_  = phrases_.intern("Scene change: ");
+        phrase_vision_blurry_ = phrases_.intern("Vision became BLURRY (Motion/Focus issue).");
+        phrase_vision_dark_   = phrases_.intern("Vision became DARK.");
+        phrase_vision_normal_ = phrases_.intern("Vision recovered to NORMAL.");
+        phrase_arm_stalled_   = phrases_.intern("Arm state changed to: STALLED (Error)");
+        phrase_arm_active_    = phrases_.intern("Arm state changed to: ACTIVE");
+        phrase_arm_idle_      = phrases_.intern("Arm state changed to: IDLE");
+        key_quality_          = phrases_.intern("quality");
+        key_label_            = phrases_.intern("label");
+        key_id_               = phrases_.intern("id");
+        key_count_            = phrases_.intern("count");
+        key_moving_           = phrases_.intern("moving");
+        key_appeared_         = phrases_.intern("appeared");
+        key_gone_             = phrases_.intern("gone");
+        key_changed_          = phrases_.intern("changed");
+        emitted_items_.reserve(64);
+        current_items_.reserve(64);
+    }
+
     // 通用添加接口
-    void addEvent(titan::core::EventType type, const std::string& summary, const json& data = {}) {
-        titan::core::CognitiveEvent evt;
-        evt.timestamp = std::chrono::steady_clock::now();
-        evt.type = type;
-        evt.summary = summary;
-        evt.detailed_data = data;
-        
-        stream_.push_back(evt);
-        if (stream_.size() > MAX_HISTORY) stream_.pop_front();
+    // 摘要原样拷入 Arena；data 非空时编码成二进制明细 (JSON 在调用方已构造，这里不再保留)
+    void addEvent(titan::core::EventType type, std::string_view summary, const json& data = {}) {
+        DetailWriter w(detail_scratch_);
+        w.encode(data, phrases_);
+        appendRecord(type, NO_PHRASE, summary, detail_scratch_);
     }
 
     // --- [新增] 感知数据融合接口 ---
-    
+
+    // 视觉事件限流: min_interval_sec 内最多发出一条视觉事件；
+    // 场景持续不变超过 keyframe_interval_sec 时补发一次全量快照 (0 = 不补发)
+    void setVisualRateLimit(double min_interval_sec, double keyframe_interval_sec = 30.0) {
+        visual_min_interval_ = min_interval_sec;
+        visual_keyframe_interval_ = keyframe_interval_sec;
+    }
+
+    // 连续的同类视觉事件 (快照 / 场景变化) 在 window_sec 内合并成一行，只保留最新的场景并计数 (0 = 只合并完全相同的事件)
+    void setMergeWindow(double window_sec) { merge_window_ = window_sec; }
+
     // 1. 注入视觉感知 (带去重和语义化)
-    void addVisualContext(const titan::core::FusedContext& ctx) {
+    // tracked 非空时按实体 track_id 做变化检测 (出现 / 消失 / 运动状态变化)，
+    // 否则退化为按检测类别计数做变化检测。只有集合发生变化才会写入事件。
+    void addVisualContext(const titan::core::FusedContext& ctx,
+                          const std::vector<titan::core::WorldEntity*>* tracked = nullptr) {
+        if (tracked) {
+            current_items_.clear();
+            for (const auto* ent : *tracked) {
+                if (ent->age < MIN_ENTITY_AGE) continue;
+                VisibleItem item;
+                item.key = ent->track_id;
+                item.label = phrases_.intern(ent->category);
+                item.moving = ent->velocity.norm() > MOVING_SPEED;
+                current_items_.push_back(item);
+            }
+            std::sort(current_items_.begin(), current_items_.end(),
+                      [](const VisibleItem& a, const VisibleItem& b) { return a.key < b.key; });
+            emitVisualChanges(true);
+        }
+
         if (!ctx.vision.has_value()) return;
         const auto& frame = ctx.vision.value();
 
         // A. 记录画质变化 (状态事件)
         if (frame.quality != last_visual_quality_) {
-            std::string status_desc;
-            if (frame.quality == titan::core::FrameQuality::BLURRY) status_desc = "Vision became BLURRY (Motion/Focus issue).";
-            else if (frame.quality == titan::core::FrameQuality::DARK) status_desc = "Vision became DARK.";
-            else if (frame.quality == titan::core::FrameQuality::VALID) status_desc = "Vision recovered to NORMAL.";
-            
-            addEvent(titan::core::EventType::PERCEPTION_BODY, status_desc, {{"quality", (int)frame.quality}});
+            PhraseId status_desc = NO_PHRASE;
+            if (frame.quality == titan::core::FrameQuality::BLURRY) status_desc = phrase_vision_blurry_;
+            else if (frame.quality == titan::core::FrameQuality::DARK) status_desc = phrase_vision_dark_;
+            else if (frame.quality == titan::core::FrameQuality::VALID) status_desc = phrase_vision_normal_;
+
+            DetailWriter w(detail_scratch_);
+            w.beginObject();
+            w.key(key_quality_); w.value(static_cast<int64_t>(frame.quality));
+            w.endObject();
+            appendRecord(titan::core::EventType::PERCEPTION_BODY, status_desc, {}, detail_scratch_);
             last_visual_quality_ = frame.quality;
         }
 
-        // B. 记录关键检测 (内容事件)
-        // 只有当画面清晰且有检测结果时才记录，避免刷屏
-        if (frame.quality == titan::core::FrameQuality::VALID && !frame.detections.empty()) {
-            json det_list = json::array();
-            std::string summary = "Saw objects: ";
+        // B. 记录检测内容的变化 (内容事件)
+        // 只在画面清晰时比较，模糊/静止帧不代表物体真的消失了
+        if (!tracked && frame.quality == titan::core::FrameQuality::VALID) {
+            current_items_.clear();
             for (const auto& det : frame.detections) {
-                summary += det.label + ", ";
-                det_list.push_back({{"label", det.label}, {"conf", det.confidence}});
+                PhraseId label = phrases_.intern(det.label);
+                auto it = std::find_if(current_items_.begin(), current_items_.end(),
+                                       [label](const VisibleItem& v) { return v.label == label; });
+                if (it != current_items_.end()) { ++it->count; continue; }
+                VisibleItem item;
+                item.key = static_cast<int>(label);
+                item.label = label;
+                current_items_.push_back(item);
             }
-            // 可以在这里加一个时间阈值，比如每秒最多记录一次视觉内容
-            addEvent(titan::core::EventType::PERCEPTION_VISUAL, summary, det_list);
+            std::sort(current_items_.begin(), current_items_.end(),
+                      [](const VisibleItem& a, const VisibleItem& b) { return a.key < b.key; });
+            emitVisualChanges(false);
         }
     }
 
     // 2. 注入自身状态 (错误/异常)
     void addSystemStatus(const titan::core::SystemStatus& status) {
         if (status.arm_state != last_arm_state_) {
-            std::string desc = "Arm state changed to: ";
-            if (status.arm_state == titan::core::ComponentState::STALLED) desc += "STALLED (Error)";
-            else if (status.arm_state == titan::core::ComponentState::ACTIVE) desc += "ACTIVE";
-            else desc += "IDLE";
-            
-            addEvent(titan::core::EventType::PERCEPTION_BODY, desc);
+            PhraseId desc = phrase_arm_idle_;
+            if (status.arm_state == titan::core::ComponentState::STALLED) desc = phrase_arm_stalled_;
+            else if (status.arm_state == titan::core::ComponentState::ACTIVE) desc = phrase_arm_active_;
+
+            detail_scratch_.clear();
+            appendRecord(titan::core::EventType::PERCEPTION_BODY, desc, {}, detail_scratch_);
             last_arm_state_ = status.arm_state;
         }
     }
 
+    // --- 读取接口 ---
+
+    size_t size() const { return ring_.size(); }
+
+    // 第 i 条事件的摘要 (0 为最旧)，按需拼接前缀与正文
+    std::string summaryAt(size_t i) const {
+        const auto& rec = ring_[i];
+        std::string s(phrases_.view(rec.prefix));
+        s += recordText(rec);
+        if (rec.repeat > 1) s += " (x" + std::to_string(rec.repeat) + ")";
+        return s;
+    }
+
+    // 第 i 条事件的明细，按需从二进制渲染为 JSON
+    json detailAt(size_t i) const {
+        const auto& rec = ring_[i];
+        DetailReader r(arena_.data(rec.block_offset) + rec.text_len, rec.detail_len, phrases_);
+        return r.read();
+    }
+
     // --- 上下文构建 ---
+
+    // 只读视图：表头 + 当前窗口内每个事件一行，增量维护，读取为 O(1)。
+    // 渲染不含时间戳等易变内容，同一事件窗口总是得到逐字节相同的文本；
+    // 两次淘汰之间只在尾部追加，已有内容可作为 LLM Prompt Cache 的稳定前缀。
+    // 注意：视图在下一次写入 stream 后失效。
+    std::string_view contextView() const {
+        return std::string_view(rendered_).substr(render_start_);
+    }
+
+    // 设置 Prompt 的 token 预算 (0 = 不限)
+    void setTokenBudget(size_t max_tokens) {
+        token_budget_ = max_tokens;
+        prompt_revision_ = UINT64_MAX;
+        prompt_valid_ = false;
+        summary_key_[0] = UINT64_MAX;
+    }
+
+    // 预算内的完整上下文: [最近事件 (3/4 预算)][分层摘要 + 被省略事件统计 (1/4 预算)]
+    // 稳定的部分在前: 最近事件区只在尾部追加，超出预算或首行被淘汰时，起点一次前移到只占 3/4 区域预算 /
+    // 越过 1/4 窗口的位置，之后又可以连续追加，LLM Prompt Cache 的前缀长期有效。
+    // 摘要区在尾部，内容变化时只重建这一段。结果按 revision 缓存；视图在下一次写入后失效。
+    std::string_view contextPrompt() {
+        if (prompt_revision_ == revision_) return prompt_cache_;
+        prompt_revision_ = revision_;
+
+        const size_t budget = token_budget_ > 0 ? token_budget_ * CHARS_PER_TOKEN : SIZE_MAX;
+        const size_t summary_budget = budget == SIZE_MAX ? SIZE_MAX : budget / 4;
+        const size_t recent_budget = budget == SIZE_MAX ? SIZE_MAX : budget - summary_budget;
+
+        syncRecentSection(recent_budget);
+        syncSummarySection(summary_budget);
+
+        prompt_cache_.resize(prompt_recent_end_);
+        prompt_cache_ += summary_cache_;
+        return prompt_cache_;
+    }
+
     std::string buildContextPrompt() {
-        std::stringstream ss;
-        ss << "### Recent Stream of Consciousness ###\n";
-        for (const auto& evt : stream_) {
-            // 时间戳转为相对时间 (e.g., T-5s)
-            ss << evt.toString() << "\n";
-        }
-        return ss.str();
+        return std::string(contextPrompt());
+    }
+
+    // 当前窗口的逐行文本 (不含表头)，即 contextView() 去掉 PROMPT_HEADER；没有 episode 日志时用作反思材料。
+    // 直接复用增量渲染结果，不解码明细。视图在下一次写入后失效
+    std::string_view transcriptView() const {
+        return contextView().substr(PROMPT_HEADER.size());
     }
-    
-    std::vector<titan::core::CognitiveEvent> getHistory() const {
-        return {stream_.begin(), stream_.end()};
+
+    // --- Episode 日志 ---
+
+    void attachEpisodeLog(EpisodeLog* log) { episode_log_ = log; }
+
+    // 标记一个新 episode (任务) 的起点，episodeRange() 从这里开始
+    void beginEpisode() { episode_start_ = std::chrono::steady_clock::now(); }
+
+    // 当前 episode 在日志中的范围快照，用于复盘学习 (不受窗口大小限制)。
+    // 只做 flush 和索引查找，回放交给持有快照的线程 (EpisodeLog::replayRange)；没挂日志时返回 nullopt
+    std::optional<EpisodeLog::Range> episodeRange() {
+        if (!episode_log_ || !episode_log_->isOpen()) return std::nullopt;
+        return episode_log_->range(episode_start_, std::chrono::steady_clock::now());
     }
 
-    // 获取完整历史用于复盘学习
-    std::vector<titan::core::CognitiveEvent> getEpisodeHistory() const {
-        return {stream_.begin(), stream_.end()};
+    void clear() {
+        ring_.clear();
+        arena_.reset();
+        rendered_.assign(PROMPT_HEADER);
+        render_start_ = 0;
+        summarizer_.clear();
+        emitted_items_.clear();
+        evicted_ = 0;
+        prompt_valid_ = false;
+        summary_key_[0] = UINT64_MAX;
+        ++revision_;
     }
-    
-    void clear() { stream_.clear(); }
 };
 
-} // namespace titan::memory
\ No newline at end of file
+} // namespace titan::memory
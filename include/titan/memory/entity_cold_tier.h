@@ -0,0 +1,101 @@
+#pragma once
+#include "memory_types.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace titan::memory {
+
+// 实体时间线的冷数据层
+//
+// EntityProfile 只在内存里保留最近的热事件 (FixedRing)；被挤出的事件交给这里：
+//   1. 后台线程把事件压缩 (msgpack) 追加写入 <dir>/entity_<id>.log，
+//      内存中只留稀疏偏移表 (每 INDEX_STRIDE 条一个检查点)，按需回读 (语义检索命中老事件时)
+//   2. 同时把事件折叠进该实体的滚动摘要，生成新的 long_term_summary，
+//      由 EntityMemoryManager 在自己的线程上取走 (takeSummaries)，后台线程从不直接改 Profile
+//   3. 保留策略: 每个实体最多保留 MAX_RECORDS 条可回读的冷记录，超出 COMPACT_SLACK 后重写文件丢弃最老的
+//      (它们已经折叠进摘要)；文件大小与偏移表都有上界
+//   4. 启动时把上次运行留下的冷文件重新折叠进摘要 (长期摘要跨重启保留)，并按同样的上限截断。
+//      事件序号每次运行从 0 开始，上次运行的记录只参与摘要，不能按序号回读
+class EntityColdTier {
+public:
+    static constexpr size_t INDEX_STRIDE = 64;
+    static constexpr size_t MAX_RECORDS = 8192;     // INDEX_STRIDE 的倍数
+    static constexpr size_t COMPACT_SLACK = 2048;   // 攒够这么多条才压缩一次，摊还重写的开销
+
+    explicit EntityColdTier(const std::string& dir);
+    ~EntityColdTier();
+
+    EntityColdTier(const EntityColdTier&) = delete;
+    EntityColdTier& operator=(const EntityColdTier&) = delete;
+
+    // 热层淘汰出的事件 (seq 为该实体内的事件序号，必须按序递增)
+    void enqueue(int entity_id, uint64_t seq, std::shared_ptr<const EntityEvent> evt);
+
+    // 按序号回读一条冷事件 (仍在队列中未落盘的也能读到)
+    std::optional<EntityEvent> load(int entity_id, uint64_t seq) const;
+
+    // 取走自上次调用以来更新过的摘要: entity_id -> long_term_summary
+    std::vector<std::pair<int, std::string>> takeSummaries();
+
+    // 阻塞直到启动重载完成且队列清空 (测试 / 关机前使用)
+    void drain();
+
+private:
+    struct Pending {
+        int entity_id;
+        uint64_t seq;
+        std::shared_ptr<const EntityEvent> evt;
+    };
+
+    // 滚动摘要的折叠状态 (只在后台线程访问)
+    struct SummaryState {
+        static constexpr size_t MAX_RECENT = 3;
+        uint64_t folded = 0;
+        TimePoint first;
+        TimePoint last;
+        std::unordered_map<std::string, uint32_t> action_counts;
+        std::deque<std::string> recent;   // 最近被折叠的几条描述
+
+        void fold(const EntityEvent& evt);
+        std::string render() const;
+    };
+
+    // 每个实体冷文件的稀疏偏移表: 回读时从最近的检查点开始，顺序跳过若干条记录的长度头
+    struct ColdIndex {
+        uint64_t first_seq = 0;              // 可回读的最早序号
+        uint64_t count = 0;                  // 从 first_seq 起连续可回读的条数
+        std::vector<uint64_t> checkpoints;   // checkpoints[i] = 序号 first_seq + i * INDEX_STRIDE 的文件偏移
+        uint64_t file_bytes = 0;
+        bool broken = false;                 // 写失败留下空洞后不再追加索引
+    };
+
+    std::string dir_;
+
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+    std::condition_variable drained_cv_;
+    std::deque<Pending> queue_;
+    std::deque<Pending> batch_;   // 后台线程正在写盘的一批 (写完前 load 仍从这里读)
+    std::unordered_map<int, ColdIndex> index_;            // 受 mtx_ 保护
+    std::unordered_map<int, std::string> ready_summaries_; // 受 mtx_ 保护
+    bool reloading_ = true;                                // 受 mtx_ 保护: 启动时的旧文件还没处理完
+
+    std::unordered_map<int, SummaryState> summaries_;     // 仅后台线程
+
+    std::thread worker_;
+    std::atomic<bool> running_{true};
+
+    void workerLoop();
+    void reloadExisting();
+    void compact(int entity_id);
+    std::string pathFor(int entity_id) const;
+};
+
+} // namespace titan::memory
@@ -1,74 +1,455 @@
 #pragma once
 #include "memory_types.h"
-#include "titan/core/math_utils.h" // 假设有 cosine_similarity
-#include <iostream>
+#include "vector_index.h"
+#include "entity_cold_tier.h"
+#include "titan/core/epoch.h"
+#include "titan/core/async_logger.h"
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 namespace titan::memory {
 
+// 实体记忆库
+//
+// 并发模型:
+//   - 按实体 ID 分成 SHARD_COUNT 个分片，每个分片一把写锁，不同分片的写入互不阻塞
+//   - 每个实体有一个独立的槽位，槽位里发布不可变的 Entry (Profile 快照 + 上下文缓存)，由 EpochDomain 保护；
+//     读者 (规划器等) 无锁读取，拿到的 shared_ptr<const EntityProfile> 可以长期持有
+//   - 写入走 copy-on-write: 复制该实体的 Profile (事件按指针共享) -> 修改 -> 只发布这个实体的新 Entry；
+//     分片目录 (实体ID -> 槽位) 只在新建实体时复制并重新发布
+//   - 每个 Profile 版本附带一个惰性构建的预序列化上下文 (EntityContext)，写入产生新版本即自然失效
+//   - 向量索引是全局单写者结构，由读写锁保护。写入方只把 Embedding 放进队列，由唯一的索引线程批量插入，
+//     感知写入不会碰索引锁；因此刚记录的事件要稍后才能被语义检索到 (需要立即可见时调用 syncIndex())
+//   - PQ 码本训练与 HNSW 建图也在索引线程上进行: 训练/建图期间只持共享锁 (检索照常走 fp32 暂存 / 精确扫描)，
+//     完成后短暂独占安装
 class EntityMemoryManager {
+public:
+    using ProfilePtr = std::shared_ptr<const EntityProfile>;
+    using ContextPtr = std::shared_ptr<const EntityContext>;
+    static constexpr size_t SHARD_COUNT = 16;
+    static constexpr int CONTEXT_EVENTS = 5;   // 缓存的上下文中包含的最近事件数
+    static constexpr size_t MAX_PENDING_EMBEDDINGS = 8192;   // 待索引队列上限，超出时丢弃 (该事件不参与语义检索)
+    static constexpr size_t INDEX_BATCH = 64;                 // 索引线程每次持独占锁插入的条数
+
 private:
-    // 全局实体库: Entity ID -> Profile
-    std::map<int, EntityProfile> entity_db_;
+    // 上下文缓存槽: 每个 Profile 版本一个，第一次有人读时才序列化 (之后同一版本的读取零开销)
+    struct ContextSlot {
+        std::once_flag once;
+        ContextPtr context;
+    };
+
+    struct Entry {
+        ProfilePtr profile;
+        std::shared_ptr<ContextSlot> context;
+    };
+
+    // 实体槽位: 生命周期与管理器相同，地址稳定；更新实体只替换槽位里的 Entry
+    struct EntitySlot {
+        titan::core::AtomicSnapshot<Entry> entry;
+
+        EntitySlot(titan::core::EpochDomain& domain, Entry initial)
+            : entry(domain, std::make_unique<const Entry>(std::move(initial))) {}
+    };
+    using Directory = std::unordered_map<int, const EntitySlot*>;
+
+    struct Shard {
+        std::mutex write_mtx;                                            // 同一分片的写者互斥
+        std::unordered_map<int, std::unique_ptr<EntitySlot>> slots;      // 写者侧，受 write_mtx 保护
+        titan::core::AtomicSnapshot<Directory> directory;
+
+        explicit Shard(titan::core::EpochDomain& domain)
+            : directory(domain, std::make_unique<const Directory>()) {}
+    };
+
+    // 待索引的 Embedding (写入方 -> 索引线程)
+    struct PendingEmbedding {
+        int entity_id;
+        uint64_t label;
+        std::vector<float> embedding;
+    };
+
+    // 必须先于分片构造、晚于分片析构 (分片退休的旧版本由它回收)
+    titan::core::EpochDomain epoch_;
+    std::array<std::unique_ptr<Shard>, SHARD_COUNT> shards_;
+
+    // 热层淘汰事件的落盘与摘要
+    EntityColdTier cold_;
+
+    // 事件 Embedding 的全局索引；label = (实体ID << 32) | 该实体内的事件序号 (热/冷层统一编号)
+    // 只有索引线程写入
+    mutable std::shared_mutex index_mtx_;
+    VectorIndex event_index_;
+    // 每个实体在索引中的行号 (实体作用域检索只扫描这些行)，受 index_mtx_ 保护
+    std::unordered_map<int, std::vector<uint32_t>> entity_rows_;
+
+    // --- 索引线程 ---
+    std::mutex queue_mtx_;
+    std::condition_variable queue_cv_;     // 唤醒索引线程
+    std::condition_variable indexed_cv_;   // 通知 syncIndex()
+    std::vector<PendingEmbedding> queue_;
+    uint64_t submitted_ = 0;               // 已入队条数
+    uint64_t indexed_ = 0;                 // 已处理条数 (含维度不符被拒绝的)
+    bool stop_ = false;
+    std::thread indexer_;
+
+    // 实体事件数不超过该值时，实体作用域直接精确扫描自己的行，比在全局图上带过滤器搜索更快也更准
+    static constexpr size_t SCOPED_EXACT_LIMIT = 4096;
+
+    static uint64_t makeLabel(int entity_id, size_t event_idx) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(entity_id)) << 32) | static_cast<uint32_t>(event_idx);
+    }
+    static int labelEntity(uint64_t label) { return static_cast<int>(static_cast<uint32_t>(label >> 32)); }
+    static uint64_t labelEvent(uint64_t label) { return label & 0xFFFFFFFFu; }
+
+    Shard& shardFor(int entity_id) const {
+        return *shards_[static_cast<uint32_t>(entity_id) % SHARD_COUNT];
+    }
+
+    void init() {
+        for (auto& s : shards_) s = std::make_unique<Shard>(epoch_);
+        indexer_ = std::thread(&EntityMemoryManager::indexerMain, this);
+    }
+
+    // 写者侧: 在持有分片写锁时修改一个实体，只发布该实体的新版本
+    template <typename Fn>
+    void mutateLocked(Shard& shard, int entity_id, Fn&& fn) {
+        auto it = shard.slots.find(entity_id);
+        const Entry* cur = it != shard.slots.end() ? it->second->entry.current() : nullptr;
+        auto profile = cur ? std::make_shared<EntityProfile>(*cur->profile) : std::make_shared<EntityProfile>();
+        fn(*profile);
+        ++profile->version;
+
+        Entry next{std::move(profile), std::make_shared<ContextSlot>()};
+        if (cur) {
+            it->second->entry.publish(std::make_unique<const Entry>(std::move(next)));
+            return;
+        }
+        // 新实体: 槽位先就绪，再发布包含它的新目录
+        auto slot = std::make_unique<EntitySlot>(epoch_, std::move(next));
+        auto dir = std::make_unique<Directory>(*shard.directory.current());
+        (*dir)[entity_id] = slot.get();
+        shard.slots.emplace(entity_id, std::move(slot));
+        shard.directory.publish(std::move(dir));
+    }
+
+    // 读者侧: 在已经 pin 住的目录里取实体的当前版本
+    static bool findEntry(const Directory& dir, int entity_id, Entry& out) {
+        auto it = dir.find(entity_id);
+        if (it == dir.end()) return false;
+        out = *it->second->entry.readPinned();
+        return true;
+    }
+
+    bool loadEntry(int entity_id, Entry& out) const {
+        auto dir = shardFor(entity_id).directory.read();
+        return findEntry(*dir, entity_id, out);
+    }
+
+    void enqueueEmbedding(int entity_id, uint64_t label, const std::vector<float>& embedding) {
+        {
+            std::lock_guard<std::mutex> lock(queue_mtx_);
+            if (queue_.size() < MAX_PENDING_EMBEDDINGS) {
+                queue_.push_back({entity_id, label, embedding});
+                ++submitted_;
+                queue_cv_.notify_one();
+                return;
+            }
+        }
+        titan::core::AsyncLogger::instance().log("[Memory] Index queue full, embedding dropped for Entity " +
+                                                 std::to_string(entity_id));
+    }
+
+    // 唯一的索引写者: 批量取出队列，分小批持独占锁插入 (两批之间检索可以插进来)
+    void indexerMain() {
+        std::vector<PendingEmbedding> batch;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(queue_mtx_);
+                queue_cv_.wait(lock, [&] { return stop_ || !queue_.empty(); });
+                if (queue_.empty()) return;   // 停止前先排空队列
+                batch.swap(queue_);
+            }
+            for (size_t begin = 0; begin < batch.size(); begin += INDEX_BATCH) {
+                size_t end = std::min(batch.size(), begin + INDEX_BATCH);
+                std::unique_lock<std::shared_mutex> index_lock(index_mtx_);
+                for (size_t i = begin; i < end; ++i) {
+                    uint32_t r = event_index_.add(batch[i].embedding, batch[i].label);
+                    if (r != VectorIndex::NPOS) entity_rows_[batch[i].entity_id].push_back(r);
+                }
+            }
+            {
+                std::lock_guard<std::mutex> lock(queue_mtx_);
+                indexed_ += batch.size();
+            }
+            indexed_cv_.notify_all();
+            batch.clear();
+            maintainIndex();
+        }
+    }
+
+    // 索引线程是唯一写者，训练/建图期间没有并发写入，安装时只需补齐 (通常为空)。
+    // 先训练码本，图建在最终的编码上
+    void maintainIndex() {
+        std::optional<QuantizedStore::Codebook> codebook;
+        {
+            std::shared_lock<std::shared_mutex> index_lock(index_mtx_);
+            if (event_index_.codebookDue()) {
+                auto t0 = std::chrono::steady_clock::now();
+                codebook = event_index_.trainCodebook();
+                logBuild("PQ codebook trained", t0);
+            }
+        }
+        if (codebook) {
+            std::unique_lock<std::shared_mutex> index_lock(index_mtx_);
+            event_index_.installCodebook(std::move(*codebook));
+        }
+
+        std::optional<VectorIndex::Graph> graph;
+        {
+            std::shared_lock<std::shared_mutex> index_lock(index_mtx_);
+            if (!event_index_.graphDue()) return;
+            auto t0 = std::chrono::steady_clock::now();
+            graph = event_index_.buildGraph();
+            logBuild("HNSW graph built", t0);
+        }
+        std::unique_lock<std::shared_mutex> index_lock(index_mtx_);
+        event_index_.installGraph(std::move(*graph));
+    }
+
+    // 调用方持有 index_mtx_ (共享即可)
+    void logBuild(const char* what, std::chrono::steady_clock::time_point t0) const {
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        titan::core::AsyncLogger::instance().log(std::string("[Memory] ") + what + " over " + std::to_string(event_index_.size()) +
+                                                 " rows in " + std::to_string(static_cast<int>(ms)) + " ms");
+    }
+
+    // 按序号取事件: 在热层直接返回，否则从冷层回读
+    std::optional<EntityEvent> eventAt(int entity_id, const EntityProfile& profile, uint64_t seq) const {
+        uint64_t first = profile.firstHotSeq();
+        if (seq >= first && seq < profile.total_events) return *profile.history[seq - first];
+        return cold_.load(entity_id, seq);
+    }
+
+    static json recentEvents(const EntityProfile& profile, int limit) {
+        json events_j = json::array();
+        const auto& hist = profile.history;
+        size_t n = std::min(hist.size(), static_cast<size_t>(std::max(limit, 0)));
+        for (size_t i = 0; i < n; ++i) {
+            events_j.push_back(hist[hist.size() - 1 - i]->toJson());
+        }
+        return events_j;
+    }
+
+    static ContextPtr buildContext(int entity_id, const EntityProfile& profile) {
+        auto ctx = std::make_shared<EntityContext>();
+        ctx->entity_id = entity_id;
+        ctx->version = profile.version;
+        ctx->attributes = json(profile.attributes).dump();
+        ctx->states = json(profile.current_states).dump();
+        ctx->summary = json(profile.long_term_summary).dump();
+        ctx->recent_history = recentEvents(profile, CONTEXT_EVENTS).dump();
+
+        // 与 getEntityContext().dump() 相同的 key 顺序
+        std::string& full = ctx->full;
+        full.reserve(ctx->attributes.size() + ctx->states.size() + ctx->summary.size() +
+                     ctx->recent_history.size() + 64);
+        full += "{\"attributes\":";
+        full += ctx->attributes;
+        full += ",\"recent_history\":";
+        full += ctx->recent_history;
+        full += ",\"states\":";
+        full += ctx->states;
+        full += ",\"summary\":";
+        full += ctx->summary;
+        full += "}";
+        return ctx;
+    }
+
+    static ContextPtr contextOf(int entity_id, const Entry& entry) {
+        ContextSlot& slot = *entry.context;
+        std::call_once(slot.once, [&] { slot.context = buildContext(entity_id, *entry.profile); });
+        return slot.context;
+    }
+
+    // 收取后台线程生成的新摘要，作为普通写入发布
+    void applySummaries() {
+        for (auto& [id, text] : cold_.takeSummaries()) {
+            Shard& shard = shardFor(id);
+            std::lock_guard<std::mutex> lock(shard.write_mtx);
+            mutateLocked(shard, id, [&text](EntityProfile& p) { p.long_term_summary = std::move(text); });
+        }
+    }
 
 public:
+    explicit EntityMemoryManager(const std::string& cold_dir = "entity_memory") : cold_(cold_dir) {
+        init();
+    }
+    EntityMemoryManager(const VectorIndex::Options& index_opts, const std::string& cold_dir = "entity_memory")
+        : cold_(cold_dir), event_index_(index_opts) {
+        init();
+    }
+
+    ~EntityMemoryManager() {
+        {
+            std::lock_guard<std::mutex> lock(queue_mtx_);
+            stop_ = true;
+        }
+        queue_cv_.notify_all();
+        if (indexer_.joinable()) indexer_.join();
+    }
+
+    EntityMemoryManager(const EntityMemoryManager&) = delete;
+    EntityMemoryManager& operator=(const EntityMemoryManager&) = delete;
+
     // --- 写入接口 ---
-    
-    // 感知层/认知层观察到事件后调用
-    void recordObservation(int entity_id, const std::string& desc, const std::string& action) {
-        EntityEvent evt;
-        evt.timestamp = std::chrono::system_clock::now();
-        evt.description = desc;
-        evt.action_type = action;
-        // evt.embedding = get_embedding_model(desc); // 调用 Embedding API
-        
-        entity_db_[entity_id].addEvent(evt);
-        
-        std::cout << "[Memory] Recorded for Entity " << entity_id << ": " << desc << std::endl;
+
+    // 感知层/认知层观察到事件后调用 (可多线程并发调用)
+    // embedding 由调用方提供 (Embedding 模型不在本模块内)，为空时该事件不参与语义检索
+    void recordObservation(int entity_id, const std::string& desc, const std::string& action,
+                           const std::vector<float>& embedding = {}) {
+        auto evt = std::make_shared<EntityEvent>();
+        evt->timestamp = std::chrono::system_clock::now();
+        evt->description = desc;
+        evt->action_type = action;
+
+        applySummaries();
+        uint64_t label = 0;
+        {
+            Shard& shard = shardFor(entity_id);
+            std::lock_guard<std::mutex> lock(shard.write_mtx);
+            mutateLocked(shard, entity_id, [&](EntityProfile& profile) {
+                label = makeLabel(entity_id, profile.total_events);
+                uint64_t oldest = profile.firstHotSeq();
+                if (auto evicted = profile.addEvent(std::move(evt))) cold_.enqueue(entity_id, oldest, std::move(evicted));
+            });
+        }
+        // 向量只以量化编码的形式存在索引里，事件本身不保留 fp32 副本；插入在分片锁之外由索引线程完成
+        if (!embedding.empty()) enqueueEmbedding(entity_id, label, embedding);
+
+        titan::core::AsyncLogger::instance().log("[Memory] Recorded for Entity " + std::to_string(entity_id) + ": " + desc);
     }
 
     // 更新属性 (Facts)
     void updateAttribute(int entity_id, const std::string& key, const std::string& value) {
-        entity_db_[entity_id].attributes[key] = value;
+        Shard& shard = shardFor(entity_id);
+        std::lock_guard<std::mutex> lock(shard.write_mtx);
+        mutateLocked(shard, entity_id, [&](EntityProfile& p) { p.attributes[key] = value; });
+    }
+
+    // 等待调用前已提交的 Embedding 全部进入索引
+    void syncIndex() {
+        std::unique_lock<std::mutex> lock(queue_mtx_);
+        uint64_t target = submitted_;
+        indexed_cv_.wait(lock, [&] { return indexed_ >= target; });
     }
 
     // --- 提取接口 (Retrieval) ---
 
-    // 1. 获取完整上下文 (用于 LLM 决策)
-    json getEntityContext(int entity_id, int limit_events = 5) {
-        if (entity_db_.find(entity_id) == entity_db_.end()) return {};
+    // 0. 实体画像快照 (无锁；不存在时返回空)
+    ProfilePtr getProfile(int entity_id) const {
+        Entry entry;
+        return loadEntry(entity_id, entry) ? entry.profile : nullptr;
+    }
 
-        const auto& profile = entity_db_[entity_id];
-        json j;
-        j["attributes"] = profile.attributes;
-        j["states"] = profile.current_states;
-        j["summary"] = profile.long_term_summary;
-        
-        // 获取最近的 N 个事件
-        json events_j = json::array();
-        int count = 0;
-        for (auto it = profile.history.rbegin(); it != profile.history.rend(); ++it) {
-            events_j.push_back(it->toJson());
-            if (++count >= limit_events) break;
+    // 1a. 预序列化的上下文 (按 Profile 版本缓存；同一版本重复读取不做任何序列化)
+    ContextPtr getEntityContextSnapshot(int entity_id) const {
+        Entry entry;
+        if (!loadEntry(entity_id, entry)) return nullptr;
+        return contextOf(entity_id, entry);
+    }
+
+    // 1b. 批量获取 (按分片分组，每个分片只进入一次读临界区)；不存在的实体对应位置为空
+    std::vector<ContextPtr> getEntityContexts(const std::vector<int>& entity_ids) const {
+        std::vector<ContextPtr> out(entity_ids.size());
+        std::vector<Entry> entries(entity_ids.size());
+        for (size_t s = 0; s < SHARD_COUNT; ++s) {
+            bool any = false;
+            for (int id : entity_ids) {
+                if (static_cast<uint32_t>(id) % SHARD_COUNT == s) { any = true; break; }
+            }
+            if (!any) continue;
+
+            auto dir = shards_[s]->directory.read();
+            for (size_t i = 0; i < entity_ids.size(); ++i) {
+                if (static_cast<uint32_t>(entity_ids[i]) % SHARD_COUNT != s) continue;
+                findEntry(*dir, entity_ids[i], entries[i]);
+            }
+        }
+        for (size_t i = 0; i < entity_ids.size(); ++i) {
+            if (entries[i].profile) out[i] = contextOf(entity_ids[i], entries[i]);
         }
-        j["recent_history"] = events_j;
+        return out;
+    }
+
+    // 1. 获取完整上下文 (JSON 对象形式，每次调用都重新构建；拼 Prompt 请用 getEntityContextSnapshot)
+    json getEntityContext(int entity_id, int limit_events = CONTEXT_EVENTS) const {
+        ProfilePtr profile = getProfile(entity_id);
+        if (!profile) return {};
+
+        json j;
+        j["attributes"] = profile->attributes;
+        j["states"] = profile->current_states;
+        j["summary"] = profile->long_term_summary;
+        j["recent_history"] = recentEvents(*profile, limit_events);
         return j;
     }
 
     // 2. 语义搜索 (RAG - Retrieval Augmented Generation)
     // "小明最近做过什么关于学习的事？" -> Query: "study learning"
-    std::vector<EntityEvent> searchEvents(int entity_id, const std::vector<float>& query_vec) {
+    // 返回该实体最相关的 top_k 个事件 (按相似度降序，低于 min_score 的丢弃)
+    std::vector<EntityEvent> searchEvents(int entity_id, const std::vector<float>& query_vec,
+                                          size_t top_k = 5, float min_score = 0.7f) const {
         std::vector<EntityEvent> results;
-        if (entity_db_.find(entity_id) == entity_db_.end()) return results;
-
-        const auto& hist = entity_db_[entity_id].history;
-        
-        // 简单的向量相似度搜索
-        // for (const auto& evt : hist) {
-        //     if (cosine_similarity(evt.embedding, query_vec) > 0.7) {
-        //         results.push_back(evt);
-        //     }
-        // }
+        ProfilePtr profile = getProfile(entity_id);
+        if (!profile) return results;
+
+        std::vector<VectorIndex::Hit> hits;
+        {
+            std::shared_lock<std::shared_mutex> index_lock(index_mtx_);
+            auto rit = entity_rows_.find(entity_id);
+            if (rit == entity_rows_.end()) return results;
+            if (!event_index_.hasGraph() || rit->second.size() <= SCOPED_EXACT_LIMIT) {
+                hits = event_index_.searchExact(query_vec, top_k, min_score, &rit->second);
+            } else {
+                VectorIndex::Filter in_scope = [entity_id](uint64_t label) { return labelEntity(label) == entity_id; };
+                hits = event_index_.search(query_vec, top_k, min_score, &in_scope);
+            }
+        }
+
+        results.reserve(hits.size());
+        for (const auto& h : hits) {
+            if (auto evt = eventAt(entity_id, *profile, labelEvent(h.label))) results.push_back(std::move(*evt));
+        }
+        return results;
+    }
+
+    // 3. 全局语义搜索 (跨所有实体)
+    std::vector<EventSearchHit> searchAllEvents(const std::vector<float>& query_vec,
+                                                size_t top_k = 5, float min_score = 0.7f) const {
+        std::vector<EventSearchHit> results;
+        std::vector<VectorIndex::Hit> hits;
+        {
+            std::shared_lock<std::shared_mutex> index_lock(index_mtx_);
+            hits = event_index_.search(query_vec, top_k, min_score);
+        }
+        results.reserve(hits.size());
+        for (const auto& h : hits) {
+            int entity_id = labelEntity(h.label);
+            ProfilePtr profile = getProfile(entity_id);
+            if (!profile) continue;
+            if (auto evt = eventAt(entity_id, *profile, labelEvent(h.label))) {
+                results.push_back({entity_id, h.score, std::move(*evt)});
+            }
+        }
         return results;
     }
 };
@@ -0,0 +1,169 @@
+#pragma once
+#include "titan/core/types.h"
+#include "nlohmann_json/json.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace titan::memory {
+
+using json = nlohmann::json;
+
+// 回放时交给回调的单条事件 (视图指向 mmap 区域，回调返回后失效)
+struct LoggedEvent {
+    titan::core::TimePoint timestamp;
+    titan::core::EventType type;
+    uint64_t seq = 0;
+    std::string_view summary;
+    const uint8_t* detail = nullptr;   // 自包含的二进制明细 (见 inlinePhrases)
+    uint32_t detail_len = 0;
+
+    json detailJson() const;
+    titan::core::CognitiveEvent toCognitiveEvent() const;
+};
+
+// 认知事件的追加式分段日志
+//
+// 目录布局:  <dir>/<session>_<NNNNNN>.tlog   事件段文件 (只追加)
+// 同一进程内的所有段构成一个 session；段文件超过 max_segment_bytes 时滚动到下一个。
+// 每写入 index_stride_bytes 记一个稀疏时间索引点，只常驻内存 (离线回放 replayFile 本来就是全量扫描)。
+// 保留策略: 本 session 最多 max_segments 个段，目录中最多 max_sessions 个 session (启动时删除最旧的)，
+// 磁盘占用上限约为 max_sessions * max_segments * max_segment_bytes。
+// append() 只把记录拷进用户态缓冲；缓冲满 / flush() 时整块交给后台写线程，
+// 写盘、滚动时的 fsync + close、新段的打开和保留策略的 unlink 都在后台线程上，调用线程从不等磁盘。
+// 后台积压超过 MAX_PENDING_BUFFERS 块 (磁盘卡顿) 时丢弃新交出的缓冲并回滚其偏移，日志是尽力而为的。
+// 回放时 mmap 顺序扫描。
+//
+// 线程模型: 单写者。append() / flush() / range() / replay() 应在同一线程调用；
+// range() 返回的快照带写入栅栏，replayRange() 可以在任意线程调用，会先等快照内的字节写到文件里。
+class EpisodeLog {
+public:
+    struct Options {
+        std::string dir = "episodes";
+        size_t max_segment_bytes = 64ull << 20;   // 64 MB 滚动
+        size_t index_stride_bytes = 64 << 10;     // 每 64 KB 一个索引点
+        size_t buffer_bytes = 64 << 10;           // 用户态写缓冲
+        size_t max_segments = 0;                  // 本 session 最多保留的段数 (0 = 不限)
+        size_t max_sessions = 0;                  // 目录中最多保留的 session 数，含本 session (0 = 不限)
+    };
+
+    static constexpr size_t MAX_PENDING_BUFFERS = 64;
+
+    // 后台写线程的进度 (快照可能比日志对象活得久，因此单独共享)
+    struct Progress {
+        std::mutex mtx;
+        std::condition_variable cv;
+        uint64_t written = 0;   // 已写入文件的缓冲字节总数
+        bool stopped = false;
+    };
+
+    explicit EpisodeLog(const Options& opts);
+    ~EpisodeLog();
+
+    EpisodeLog(const EpisodeLog&) = delete;
+    EpisodeLog& operator=(const EpisodeLog&) = delete;
+
+    bool isOpen() const { return open_; }
+
+    // summary = prefix + text (分两段传入，避免调用方拼接)
+    void append(titan::core::EventType type, titan::core::TimePoint t,
+                std::string_view prefix, std::string_view text,
+                const uint8_t* detail, size_t detail_len);
+
+    // 把当前缓冲交给后台写线程 (不等待写盘)
+    void flush();
+
+    // 一段时间范围的只读快照: 每个相关段的文件路径、起始偏移 (由稀疏索引定位) 和生成快照时已写出的长度
+    struct Range {
+        struct Part {
+            std::string path;
+            uint64_t begin = 0;
+            uint64_t end = 0;
+        };
+        std::vector<Part> parts;
+        int64_t from_ns = 0;
+        int64_t to_ns = 0;
+        std::shared_ptr<Progress> progress;   // 写入栅栏: 回放前等 progress->written 达到 fence
+        uint64_t fence = 0;
+
+        bool empty() const { return parts.empty(); }
+    };
+
+    // 写者线程: 只交出缓冲并查内存索引，不读写文件
+    Range range(titan::core::TimePoint from, titan::core::TimePoint to);
+
+    // 任意线程: 等写入栅栏后 mmap 顺序扫描快照内的记录，返回回放条数。
+    // 快照之后被保留策略删除的段直接跳过。
+    static size_t replayRange(const Range& range, const std::function<void(const LoggedEvent&)>& fn);
+
+    // 回放本 session 中 [from, to] 时间范围内的事件，返回回放条数
+    size_t replay(titan::core::TimePoint from, titan::core::TimePoint to,
+                  const std::function<void(const LoggedEvent&)>& fn);
+
+    // 离线扫描任意段文件 (不依赖 session 状态，时间戳为写入进程的 steady_clock)
+    static size_t replayFile(const std::string& path, const std::function<void(const LoggedEvent&)>& fn);
+
+    uint64_t appendedCount() const { return next_seq_; }
+    uint64_t droppedCount() const { return dropped_buffers_; }   // 因后台积压丢弃的缓冲块数
+
+private:
+    struct IndexEntry {
+        int64_t steady_ns;
+        uint64_t offset;
+    };
+    struct Segment {
+        std::string path;
+        int64_t first_ns = 0;
+        int64_t last_ns = 0;
+        std::vector<IndexEntry> index;   // 稀疏时间索引 (只在内存中)
+    };
+
+    // 交给后台写线程的命令 (按序执行)
+    struct Command {
+        enum class Kind : uint8_t { OPEN, WRITE, CLOSE, UNLINK } kind = Kind::WRITE;
+        std::string path;             // OPEN / UNLINK
+        uint64_t first_seq = 0;       // OPEN
+        std::vector<uint8_t> bytes;   // WRITE
+    };
+
+    Options opts_;
+    std::string session_;
+    std::vector<Segment> segments_;
+    size_t next_segment_no_ = 0;
+    bool open_ = false;
+    size_t segment_bytes_ = 0;     // 当前段已写入 (含缓冲) 的字节数
+    size_t last_index_at_ = 0;
+    uint64_t next_seq_ = 0;
+    uint64_t submitted_ = 0;       // 已交给写线程的缓冲字节总数
+    uint64_t dropped_buffers_ = 0;
+    std::vector<uint8_t> buffer_;
+
+    // 写线程共享状态 (受 mtx_ 保护)
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<Command> queue_;
+    std::vector<std::vector<uint8_t>> spare_buffers_;   // 写完的缓冲回收复用，稳态不分配
+    bool running_ = true;
+    std::shared_ptr<Progress> progress_ = std::make_shared<Progress>();
+    std::thread writer_;
+
+    // 写线程私有
+    int fd_ = -1;
+
+    void pruneSessions();
+    Command openSegment();
+    void closeSegment();
+    void submit(Command&& cmd);
+    bool runCommand(Command& cmd);   // 写线程 (以及构造时打开第一个段)
+    void writerLoop();
+    static void writeAll(int fd, const void* data, size_t len);
+};
+
+} // namespace titan::memory
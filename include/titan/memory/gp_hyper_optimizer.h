@@ -0,0 +1,73 @@
+#pragma once
+#include "titan/memory/sparse_gp_memory.h"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace titan::memory {
+
+// SparseGPMemory 的后台超参数优化
+//
+// submit() 拷贝一份当前支撑点 (X, y, 超参数, 数据版本) 交给工作线程，立即返回；
+// 工作线程在对数参数空间里用解析梯度 (Adam) 最大化对数边际似然:
+//   log p(y) = -½ yᵀα - Σ log L_ii - n/2 log 2π
+//   ∂/∂θ = ½ tr((ααᵀ - K⁻¹) ∂K/∂θ)
+// 收敛后在全部数据上按新超参数重新分解，把 GPHyperUpdate 原子地放进结果槽；
+// 学习线程用 take() 取走并交给 SparseGPMemory::applyHyperUpdate。控制线程不参与任何一步。
+class GPHyperOptimizer {
+public:
+    struct Options {
+        bool ard = true;            // 每维独立的长度尺度
+        int max_iters = 60;
+        double step = 0.05;         // Adam 步长 (对数空间)
+        size_t max_points = 1000;   // 支撑点更多时随机抽样优化 (每次迭代 O(n³))
+        size_t min_points = 8;      // 数据太少时不优化
+    };
+
+    GPHyperOptimizer() : GPHyperOptimizer(Options{}) {}
+    explicit GPHyperOptimizer(const Options& opts);
+    ~GPHyperOptimizer();
+
+    GPHyperOptimizer(const GPHyperOptimizer&) = delete;
+    GPHyperOptimizer& operator=(const GPHyperOptimizer&) = delete;
+
+    // 非阻塞；若上一份快照还没开始处理则被替换
+    void submit(const SparseGPMemory& gp);
+
+    // 正在优化或有待处理的快照
+    bool busy() const;
+
+    // 取走最近一次完成的结果 (没有则返回空)
+    std::unique_ptr<GPHyperUpdate> take();
+
+    // 对数边际似然；grad 非空时写入对数参数的梯度:
+    //   [log ℓ_1..log ℓ_d (ARD) 或 log ℓ, log signal_var, log noise_var]
+    static double logMarginalLikelihood(const Eigen::MatrixXd& X, const Eigen::VectorXd& y,
+                                        const GPHyperParams& params, bool ard, Eigen::VectorXd* grad);
+
+private:
+    struct Job {
+        Eigen::MatrixXd X;
+        Eigen::VectorXd y;
+        GPHyperParams init;
+        uint64_t data_version = 0;
+    };
+
+    Options opts_;
+
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+    std::unique_ptr<Job> pending_;
+    bool working_ = false;
+    bool running_ = true;
+
+    std::atomic<GPHyperUpdate*> result_{nullptr};
+    std::thread worker_;
+
+    void workerLoop();
+    std::unique_ptr<GPHyperUpdate> optimize(const Job& job) const;
+};
+
+} // namespace titan::memory
@@ -1,9 +1,11 @@
 #pragma once
 #include "titan/core/types.h"
+#include "titan/core/ring_buffer.h"
 #include <string>
 #include <vector>
 #include <map>
 #include <chrono>
+#include <memory>
 #include <nlohmann_json/json.hpp> // 用于序列化给 LLM
 
 namespace titan::memory {
@@ -21,6 +23,7 @@ struct EntityEvent {
     std::string action_type; // 动作类型: "write", "move", "speak"
     
     // 语义嵌入 (用于 RAG 检索)
+    // 写入 EntityMemoryManager 时向量量化存放在其向量索引中，库内事件的这个字段为空
     std::vector<float> embedding; 
     
     // 关联的其他实体 ID (形成图谱连接)
@@ -37,6 +40,25 @@ struct EntityEvent {
     }
 };
 
+// 语义检索命中的事件 (全局检索时需要知道属于哪个实体)
+struct EventSearchHit {
+    int entity_id;
+    float score;
+    EntityEvent event;
+};
+
+// 预序列化的实体上下文 (给 LLM 的 Prompt 片段)
+// 每个字段都是已经 dump 好的 JSON 文本，拼 Prompt 时直接追加，不再经过 nlohmann::json
+struct EntityContext {
+    int entity_id = 0;
+    uint64_t version = 0;         // 对应的 EntityProfile::version
+    std::string attributes;       // JSON 对象
+    std::string states;           // JSON 数组
+    std::string summary;          // JSON 字符串
+    std::string recent_history;   // JSON 数组 (最近的若干事件，新的在前)
+    std::string full;             // 完整的上下文对象
+};
+
 // 2. 实体画像 (Semantic Profile)
 // 存储属性和状态
 struct EntityProfile {
@@ -49,17 +71,31 @@ struct EntityProfile {
     std::vector<std::string> current_states;
 
     // 3. 动态时间线 (The Timeline)
-    // 存储该实体参与的历史事件
-    std::vector<EntityEvent> history;
-    
+    // 内存里只保留最近 HOT_HISTORY 条 (热层)；更早的事件由 EntityColdTier 落盘，
+    // 并由后台线程折叠进 long_term_summary，长期存在的实体不会让内存和上下文构建无限增长。
+    // 事件本身不可变、按指针共享，复制 Profile (发布新快照) 时不复制事件内容。
+    static constexpr size_t HOT_HISTORY = 64;
+    titan::core::FixedRing<std::shared_ptr<const EntityEvent>> history{HOT_HISTORY};
+    uint64_t total_events = 0;   // 累计事件数 (也是下一条事件的序号)
+    uint64_t version = 0;        // 每次写入递增，用于判断缓存的上下文是否过期
+
     // 记忆摘要 (Long-term Summary)
-    // 当 history 过长时，由 LLM 压缩成一段话存这就好
+    // 被挤出热层的事件的滚动摘要
     std::string long_term_summary; 
 
-    // 添加事件
-    void addEvent(const EntityEvent& evt) {
-        history.push_back(evt);
-        // 实际工程中这里需要 RingBuffer 机制或存入数据库
+    // 热层中最旧事件的序号
+    uint64_t firstHotSeq() const { return total_events - history.size(); }
+
+    // 添加事件；热层已满时返回被挤出的最旧事件 (序号为添加前的 firstHotSeq())，否则返回空
+    std::shared_ptr<const EntityEvent> addEvent(std::shared_ptr<const EntityEvent> evt) {
+        std::shared_ptr<const EntityEvent> evicted;
+        if (history.full()) {
+            evicted = std::move(history.front());
+            history.pop_front();
+        }
+        history.push_back(std::move(evt));
+        ++total_events;
+        return evicted;
     }
 };
 
@@ -0,0 +1,386 @@
+#pragma once
+#include "titan/core/math_utils.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace titan::memory {
+
+// 向量的存储精度
+enum class Quantization : uint8_t {
+    FP32,   // 原始精度 (4 字节 / 维)
+    INT8,   // 标量量化: 每个向量一个 scale + 每维 1 字节，约 4x
+    PQ      // 乘积量化: 每 pq_subvector_dim 维 1 字节 (256 个质心)，默认约 16x
+};
+
+// 量化 Embedding 存储
+//
+// 所有向量 (归一化后) 的编码定长、连续存放在一块 arena 里，没有逐条的堆分配。
+// 相似度直接在编码上计算 (非对称: 查询保持 fp32)：
+//   - INT8: int8 -> fp32 的 SIMD 点积，再乘 scale
+//   - PQ:   每次查询预先算好 子空间 x 质心 的查找表，逐字节查表累加
+// keep_full_precision 时额外保留 fp32 原始向量，用于对粗排候选做精确重排。
+//
+// PQ 需要训练码本：码本就绪之前向量先以 fp32 暂存 (此时检索是精确的)。攒够 pq_train_size 条后
+// trainingDue() 为真，由调用方在后台 trainPQ() (const，可与查询并发) 再 installPQ() (写入，只做安装与补齐)，
+// 之后直接编码写入。
+class QuantizedStore {
+public:
+    struct Options {
+        Quantization mode = Quantization::INT8;
+        size_t pq_subvector_dim = 4;
+        size_t pq_train_size = 1024;
+        bool keep_full_precision = false;
+    };
+
+    // 每次查询预处理的结果 (调用方复用，稳态不分配)
+    struct Query {
+        std::vector<float> vec;     // 归一化、补齐到 stride 的查询向量
+        std::vector<float> table;   // PQ: [子空间][质心] 点积表
+    };
+
+    // trainPQ() 的结果: 码本 + 训练时已有的前 rows 行的编码
+    struct Codebook {
+        std::vector<float> centroids;   // [子空间][质心][子空间维度]
+        std::vector<uint8_t> codes;     // rows x code_bytes
+        size_t rows = 0;
+    };
+
+    static constexpr uint32_t NPOS = 0xFFFFFFFFu;
+    static constexpr size_t PQ_CENTROIDS = 256;
+    static constexpr int PQ_TRAIN_ITERS = 10;
+
+private:
+    Options opts_;
+    size_t dim_ = 0;
+    size_t stride_ = 0;       // 补齐后的维度 (8 的倍数，PQ 时同时是子空间维度的倍数)
+    size_t code_bytes_ = 0;   // 每个向量的编码字节数
+    size_t count_ = 0;
+
+    std::vector<uint8_t> codes_;   // count_ x code_bytes_
+    std::vector<float> full_;      // keep_full_precision 时的原始 (归一化) 向量
+
+    // --- PQ ---
+    size_t pq_m_ = 0;                // 子空间个数
+    std::vector<float> codebook_;    // [子空间][质心][子空间维度]
+    bool pq_trained_ = false;
+    std::vector<float> pending_;     // 码本训练前暂存的 fp32 向量
+
+    const uint8_t* code(uint32_t r) const { return codes_.data() + static_cast<size_t>(r) * code_bytes_; }
+    uint8_t* code(uint32_t r) { return codes_.data() + static_cast<size_t>(r) * code_bytes_; }
+
+    const float* centroid(size_t m, size_t c) const {
+        return codebook_.data() + (m * PQ_CENTROIDS + c) * opts_.pq_subvector_dim;
+    }
+
+    void encodeInt8(const float* v, uint8_t* out) const {
+        float max_abs = 0.f;
+        for (size_t i = 0; i < dim_; ++i) max_abs = std::max(max_abs, std::abs(v[i]));
+        float scale = max_abs > 0.f ? max_abs / 127.f : 1.f;
+        float inv = 1.f / scale;
+        std::memcpy(out, &scale, sizeof(float));
+        int8_t* q = reinterpret_cast<int8_t*>(out + sizeof(float));
+        for (size_t i = 0; i < stride_; ++i) {
+            q[i] = static_cast<int8_t>(std::clamp(std::lround(v[i] * inv), -127L, 127L));
+        }
+    }
+
+    void encodePQ(const float* v, uint8_t* out) const { encodePQ(codebook_.data(), v, out); }
+
+    void encodePQ(const float* codebook, const float* v, uint8_t* out) const {
+        const size_t sd = opts_.pq_subvector_dim;
+        for (size_t m = 0; m < pq_m_; ++m) {
+            const float* sub = v + m * sd;
+            float best = std::numeric_limits<float>::max();
+            size_t best_c = 0;
+            for (size_t c = 0; c < PQ_CENTROIDS; ++c) {
+                const float* cen = codebook + (m * PQ_CENTROIDS + c) * sd;
+                float d = 0.f;
+                for (size_t i = 0; i < sd; ++i) {
+                    float diff = sub[i] - cen[i];
+                    d += diff * diff;
+                }
+                if (d < best) {
+                    best = d;
+                    best_c = c;
+                }
+            }
+            out[m] = static_cast<uint8_t>(best_c);
+        }
+    }
+
+    bool pqPending() const { return opts_.mode == Quantization::PQ && !pq_trained_; }
+
+    // 归一化并补齐到 stride_ (结果放在线程局部缓冲里)
+    const std::vector<float>& normalized(const std::vector<float>& vec) const {
+        thread_local std::vector<float> v;
+        v.assign(stride_, 0.f);
+        std::copy(vec.begin(), vec.end(), v.begin());
+        titan::core::VectorMath::normalize(v.data(), dim_);
+        return v;
+    }
+
+    // 编码写入已分配的第 r 行
+    void writeRow(uint32_t r, const std::vector<float>& v) {
+        if (opts_.keep_full_precision) std::copy(v.begin(), v.end(), full_.begin() + static_cast<size_t>(r) * stride_);
+        switch (opts_.mode) {
+            case Quantization::FP32:
+                std::memcpy(code(r), v.data(), code_bytes_);
+                break;
+            case Quantization::INT8:
+                encodeInt8(v.data(), code(r));
+                break;
+            case Quantization::PQ:
+                if (pq_trained_) {
+                    encodePQ(v.data(), code(r));
+                } else {
+                    std::copy(v.begin(), v.end(), pending_.begin() + static_cast<size_t>(r) * stride_);
+                }
+                break;
+        }
+    }
+
+public:
+    QuantizedStore() = default;
+    explicit QuantizedStore(const Options& opts) : opts_(opts) {
+        if (opts_.pq_subvector_dim == 0) opts_.pq_subvector_dim = 4;
+        if (opts_.pq_train_size == 0) opts_.pq_train_size = 1;
+    }
+
+    size_t size() const { return count_; }
+    size_t dim() const { return dim_; }
+    size_t stride() const { return stride_; }
+    Quantization mode() const { return opts_.mode; }
+    bool hasFullPrecision() const { return opts_.keep_full_precision; }
+    bool trainingDue() const { return pqPending() && count_ >= opts_.pq_train_size; }
+
+    // 每个子空间独立做 k-means (Lloyd)，初始质心为随机抽样；用当前暂存的全部向量训练并编码。
+    // 只读存储，可以与查询并发，不能与写入并发
+    Codebook trainPQ() const {
+        Codebook out;
+        if (!trainingDue()) return out;
+        const size_t sd = opts_.pq_subvector_dim;
+        const size_t n = pending_.size() / stride_;
+        out.centroids.assign(pq_m_ * PQ_CENTROIDS * sd, 0.f);
+        std::mt19937 rng(0x5eedu);
+        std::vector<float> sums(PQ_CENTROIDS * sd);
+        std::vector<uint32_t> counts(PQ_CENTROIDS);
+
+        for (size_t m = 0; m < pq_m_; ++m) {
+            float* cb = out.centroids.data() + m * PQ_CENTROIDS * sd;
+            auto sub = [&](size_t i) { return pending_.data() + i * stride_ + m * sd; };
+
+            std::vector<uint32_t> order(n);
+            std::iota(order.begin(), order.end(), 0);
+            std::shuffle(order.begin(), order.end(), rng);
+            for (size_t c = 0; c < PQ_CENTROIDS; ++c) std::copy_n(sub(order[c % n]), sd, cb + c * sd);
+
+            for (int it = 0; it < PQ_TRAIN_ITERS; ++it) {
+                std::fill(sums.begin(), sums.end(), 0.f);
+                std::fill(counts.begin(), counts.end(), 0);
+                for (size_t i = 0; i < n; ++i) {
+                    const float* x = sub(i);
+                    float best = std::numeric_limits<float>::max();
+                    uint32_t best_c = 0;
+                    for (size_t c = 0; c < PQ_CENTROIDS; ++c) {
+                        float d = 0.f;
+                        for (size_t k = 0; k < sd; ++k) {
+                            float diff = x[k] - cb[c * sd + k];
+                            d += diff * diff;
+                        }
+                        if (d < best) {
+                            best = d;
+                            best_c = static_cast<uint32_t>(c);
+                        }
+                    }
+                    ++counts[best_c];
+                    for (size_t k = 0; k < sd; ++k) sums[best_c * sd + k] += x[k];
+                }
+                for (size_t c = 0; c < PQ_CENTROIDS; ++c) {
+                    if (counts[c] == 0) {
+                        // 空簇: 重新抽一个样本，避免质心浪费
+                        std::copy_n(sub(rng() % n), sd, cb + c * sd);
+                        continue;
+                    }
+                    for (size_t k = 0; k < sd; ++k) cb[c * sd + k] = sums[c * sd + k] / counts[c];
+                }
+            }
+        }
+
+        out.rows = n;
+        out.codes.resize(n * code_bytes_);
+        for (size_t r = 0; r < n; ++r) {
+            encodePQ(out.centroids.data(), pending_.data() + r * stride_, out.codes.data() + r * code_bytes_);
+        }
+        return out;
+    }
+
+    // 安装 trainPQ() 的结果，补编码训练之后新增的行，释放 fp32 暂存 (写入)
+    void installPQ(Codebook&& cb) {
+        if (!pqPending() || cb.centroids.empty()) return;
+        codebook_ = std::move(cb.centroids);
+        std::copy(cb.codes.begin(), cb.codes.end(), codes_.begin());
+        for (size_t r = cb.rows; r < count_; ++r) encodePQ(pending_.data() + r * stride_, code(static_cast<uint32_t>(r)));
+        pending_.clear();
+        pending_.shrink_to_fit();
+        pq_trained_ = true;
+    }
+
+    // 每个向量常驻的字节数 (不含训练前的暂存)
+    size_t bytesPerVector() const {
+        return code_bytes_ + (opts_.keep_full_precision ? stride_ * sizeof(float) : 0);
+    }
+
+    void reserve(size_t rows) {
+        if (code_bytes_ == 0) return;
+        codes_.reserve(rows * code_bytes_);
+        if (opts_.keep_full_precision) full_.reserve(rows * stride_);
+    }
+
+    // 归一化后编码入库，返回行号；维度不一致时返回 NPOS
+    uint32_t add(const std::vector<float>& vec) {
+        if (vec.empty()) return NPOS;
+        if (dim_ == 0) {
+            dim_ = vec.size();
+            size_t align = opts_.mode == Quantization::PQ ? std::lcm<size_t>(8, opts_.pq_subvector_dim) : 8;
+            stride_ = (dim_ + align - 1) / align * align;
+            switch (opts_.mode) {
+                case Quantization::FP32: code_bytes_ = stride_ * sizeof(float); break;
+                case Quantization::INT8: code_bytes_ = sizeof(float) + stride_; break;
+                case Quantization::PQ:
+                    pq_m_ = stride_ / opts_.pq_subvector_dim;
+                    code_bytes_ = pq_m_;
+                    break;
+            }
+        }
+        if (vec.size() != dim_) {
+            std::cerr << "[QuantizedStore] Dimension mismatch: " << vec.size() << " vs " << dim_ << std::endl;
+            return NPOS;
+        }
+
+        const auto& v = normalized(vec);
+        uint32_t r = static_cast<uint32_t>(count_++);
+        codes_.resize(count_ * code_bytes_);
+        if (opts_.keep_full_precision) full_.resize(count_ * stride_);
+        if (pqPending()) pending_.resize(count_ * stride_);
+        writeRow(r, v);
+        return r;
+    }
+
+    // 原地覆盖第 r 行 (行号不变，arena 不增长)；行号越界或维度不一致时返回 false
+    bool set(uint32_t r, const std::vector<float>& vec) {
+        if (r >= count_) return false;
+        if (vec.size() != dim_) {
+            std::cerr << "[QuantizedStore] Dimension mismatch: " << vec.size() << " vs " << dim_ << std::endl;
+            return false;
+        }
+        writeRow(r, normalized(vec));
+        return true;
+    }
+
+    // 还原出 (近似的) 归一化向量，长度为 stride()
+    void decode(uint32_t r, float* out) const {
+        if (opts_.keep_full_precision) {
+            std::copy_n(full_.data() + static_cast<size_t>(r) * stride_, stride_, out);
+            return;
+        }
+        switch (opts_.mode) {
+            case Quantization::FP32:
+                std::memcpy(out, code(r), code_bytes_);
+                break;
+            case Quantization::INT8: {
+                float scale;
+                std::memcpy(&scale, code(r), sizeof(float));
+                const int8_t* q = reinterpret_cast<const int8_t*>(code(r) + sizeof(float));
+                for (size_t i = 0; i < stride_; ++i) out[i] = q[i] * scale;
+                break;
+            }
+            case Quantization::PQ:
+                if (pqPending()) {
+                    std::copy_n(pending_.data() + static_cast<size_t>(r) * stride_, stride_, out);
+                    break;
+                }
+                for (size_t m = 0; m < pq_m_; ++m) {
+                    std::copy_n(centroid(m, code(r)[m]), opts_.pq_subvector_dim, out + m * opts_.pq_subvector_dim);
+                }
+                break;
+        }
+    }
+
+    // 查询预处理: 归一化 + (PQ) 查找表
+    bool prepare(const std::vector<float>& query, Query& q) const {
+        if (query.size() != dim_ || dim_ == 0) return false;
+        q.vec.assign(stride_, 0.f);
+        std::copy(query.begin(), query.end(), q.vec.begin());
+        titan::core::VectorMath::normalize(q.vec.data(), dim_);
+        buildTable(q);
+        return true;
+    }
+
+    // 以库中第 r 条向量作为查询 (建图时使用)
+    void prepareStored(uint32_t r, Query& q) const {
+        q.vec.resize(stride_);
+        decode(r, q.vec.data());
+        buildTable(q);
+    }
+
+    void buildTable(Query& q) const {
+        if (opts_.mode != Quantization::PQ || !pq_trained_) return;
+        const size_t sd = opts_.pq_subvector_dim;
+        q.table.resize(pq_m_ * PQ_CENTROIDS);
+        for (size_t m = 0; m < pq_m_; ++m) {
+            const float* sub = q.vec.data() + m * sd;
+            for (size_t c = 0; c < PQ_CENTROIDS; ++c) {
+                q.table[m * PQ_CENTROIDS + c] = titan::core::VectorMath::dot(sub, centroid(m, c), sd);
+            }
+        }
+    }
+
+    // 基于编码的相似度 (粗排)
+    float score(const Query& q, uint32_t r) const {
+        switch (opts_.mode) {
+            case Quantization::FP32:
+                return titan::core::VectorMath::dot(q.vec.data(), reinterpret_cast<const float*>(code(r)), stride_);
+            case Quantization::INT8: {
+                float scale;
+                std::memcpy(&scale, code(r), sizeof(float));
+                return scale * titan::core::VectorMath::dotInt8(
+                    reinterpret_cast<const int8_t*>(code(r) + sizeof(float)), q.vec.data(), stride_);
+            }
+            case Quantization::PQ: {
+                if (pqPending()) {
+                    return titan::core::VectorMath::dot(q.vec.data(), pending_.data() + static_cast<size_t>(r) * stride_, stride_);
+                }
+                const uint8_t* c = code(r);
+                const float* t = q.table.data();
+                float s = 0.f;
+                for (size_t m = 0; m < pq_m_; ++m, t += PQ_CENTROIDS) s += t[c[m]];
+                return s;
+            }
+        }
+        return 0.f;
+    }
+
+    // 精确相似度 (有 fp32 原始向量时)；否则等同于 score()
+    float exactScore(const Query& q, uint32_t r) const {
+        if (!opts_.keep_full_precision) return score(q, r);
+        return titan::core::VectorMath::dot(q.vec.data(), full_.data() + static_cast<size_t>(r) * stride_, stride_);
+    }
+
+    // 库内两条向量的相似度 (建图选邻居用，冷路径)
+    float similarity(uint32_t a, uint32_t b) const {
+        thread_local std::vector<float> va, vb;
+        va.resize(stride_);
+        vb.resize(stride_);
+        decode(a, va.data());
+        decode(b, vb.data());
+        return titan::core::VectorMath::dot(va.data(), vb.data(), stride_);
+    }
+};
+
+} // namespace titan::memory
@@ -1,37 +1,138 @@
 #pragma once
 #include "titan/core/types.h"
+#include <memory>
 #include <vector>
 
 namespace titan::memory {
 
+// RBF 核超参数: k(a, b) = signal_var · exp(-½ Σ_d (a_d - b_d)² / len_scales_d²)
+struct GPHyperParams {
+    Eigen::VectorXd len_scales;   // 每维长度尺度 (ARD)；非 ARD 时各维取同一个值
+    double signal_var = 1.0;
+    double noise_var = 0.1;
+};
+
+// 后台超参数优化的一次产出: 新超参数 + 在同一版本数据上刷新好的分解
+struct GPHyperUpdate {
+    GPHyperParams params;
+    uint64_t data_version = 0;     // 优化所用数据的版本 (见 SparseGPMemory::dataVersion)
+    double log_likelihood = 0.0;
+    Eigen::MatrixXd L;             // n×n 下三角
+    Eigen::VectorXd alpha;
+    Eigen::VectorXd q_diag;
+};
+
+// 只读预测快照: 只拷贝预测要用的有效部分 (X: d×n, ||x||²_W, alpha, 左上 n×n 的 L, 超参数)，
+// 不含按 max_nodes + 1 预分配的余量与学习侧的簿记 (score、q_diag 等)。
+// 占用约 8·(d·n + n² + 2n + d) 字节；默认 n = 100 时不到 100KB。
+class GPPredictor {
+public:
+    // 预测用的临时缓冲，由调用方持有并复用；容量足够时 predict 不分配内存
+    struct Workspace {
+        Eigen::VectorXd k;    // 核向量 k*，随后原地变成 L⁻¹ k*
+        Eigen::VectorXd wx;   // W·x
+
+        void reserve(size_t nodes, size_t dim) {
+            if (k.size() < static_cast<Eigen::Index>(nodes)) k.resize(static_cast<Eigen::Index>(nodes));
+            if (wx.size() < static_cast<Eigen::Index>(dim)) wx.resize(static_cast<Eigen::Index>(dim));
+        }
+    };
+
+    // 与 SparseGPMemory::predict 结果一致
+    std::pair<double, double> predict(const Eigen::VectorXd& x, Workspace& ws) const;
+    std::pair<double, double> predict(const Eigen::VectorXd& x) const {
+        Workspace ws;
+        return predict(x, ws);
+    }
+    size_t size() const { return static_cast<size_t>(alpha_.size()); }
+
+private:
+    friend class SparseGPMemory;
+    Eigen::MatrixXd X_;        // d × n
+    Eigen::VectorXd x_sq_;
+    Eigen::VectorXd alpha_;
+    Eigen::MatrixXd L_;        // n × n 下三角
+    Eigen::VectorXd w_;
+    double signal_var_ = 1.0;
+};
+
+// 稀疏高斯过程 "肌肉记忆" (RBF 核，支撑点数有预算上限 max_nodes)
+//
+// 维护 K + σ²I 的 Cholesky 因子 L、alpha = (K + σ²I)⁻¹ y 与 diag((K + σ²I)⁻¹)：
+//   插入节点: L 末尾追加一行 (一次三角求解, O(n²))
+//   删除节点: 删去对应行列，右下块做一次 rank-one 更新 (O(n²))
+//   预测:     均值 k*ᵀ alpha 为 O(n)；方差 k** - ||L⁻¹ k*||² 需要一次三角求解, O(n²)
+// 默认预算 100，FEPController::solve 每个控制周期调用一次 predict，耗时在微秒级；
+// 预算可以放大到 1k-5k (离线评估 / predictBatch)，单点方差的代价随 n² 增长。
+//
+// 预算已满时新样本先加入，再按 Csató-Opper 得分 alpha_i² / [(K + σ²I)⁻¹]_ii
+// (删掉该点后后验均值的变化量) 换出得分最低的节点 —— 可能就是新样本本身。
+//
+// 支撑点特征按列连续存放在 d×n 矩阵中，核矩阵按块计算 (W = diag(1/ℓ²))：
+//   ||a - b||²_W = ||a||²_W + ||b||²_W - 2aᵀWb，其中 AᵀWB 走 GEMM
 class SparseGPMemory {
 public:
-    SparseGPMemory(); // 构造函数
-    
-    std::pair<double, double> predict(const Eigen::VectorXd& x);
+    static constexpr size_t DEFAULT_MAX_NODES = 100;
+
+    explicit SparseGPMemory(size_t max_nodes = DEFAULT_MAX_NODES);
+
+    // 返回 (均值, 方差)；没有记忆时返回 (0, 100) 表示完全不确定
+    std::pair<double, double> predict(const Eigen::VectorXd& x) const;
+
+    // 批量预测: queries 为 d×m (每列一个查询点)，返回 (均值, 方差) 两个长度 m 的向量
+    std::pair<Eigen::VectorXd, Eigen::VectorXd> predictBatch(const Eigen::MatrixXd& queries) const;
+
+    // 当前状态的只读预测快照 (O(d·n + n²) 拷贝)，供控制线程无锁读取
+    std::unique_ptr<const GPPredictor> predictor() const;
+
+    // surprise 作为节点元数据保存；是否保留由信息量决定
     void learn(const Eigen::VectorXd& x, double y, double surprise);
-    void save(const std::string& path);
-    void load(const std::string& path);
+    // 二进制持久化 (支撑点、超参数，以及缓存的 Cholesky 因子 / alpha / diag(K⁻¹))
+    // save: 先写 path.tmp 再 rename，崩溃时旧文件保持完整
+    // load: mmap 后按列 memcpy 回预分配的缓冲，不做任何分解；文件缺失 / 损坏时保持当前状态
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+    size_t size() const { return static_cast<size_t>(n_); }
+    size_t capacity() const { return max_nodes_; }
+
+    // --- 超参数 (由 GPHyperOptimizer 在后台优化) ---
+    const GPHyperParams& hyperParams() const { return hyper_; }
+    // 支撑点集合每变化一次加一；用来判断后台结果是否基于当前数据
+    uint64_t dataVersion() const { return data_version_; }
+    Eigen::MatrixXd features() const { return X_.leftCols(n_); }
+    Eigen::VectorXd outcomes() const { return y_.head(n_); }
+
+    // 采用新的超参数: 数据版本一致时直接换入后台算好的分解 (O(n²) 拷贝)，否则在本线程重新分解
+    void applyHyperUpdate(const GPHyperUpdate& update);
 
 private:
-    struct MemoryNode {
-        Eigen::VectorXd features;
-        double outcome;
-        double score;
-    };
-    
     // 私有辅助函数
-    double kernel(const Eigen::VectorXd& x1, const Eigen::VectorXd& x2);
-    void recompute();
-    void pruneRedundant(const Eigen::VectorXd& x_new);
-
-    std::vector<MemoryNode> nodes_;
-    Eigen::MatrixXd K_inv_;
-    bool dirty_;
-    const size_t MAX_NODES = 100;
-    double len_scale_;
-    double noise_var_;
-    double signal_var_;
+    // 核矩阵块: A (d×p, 列平方范数 a_sq) 与 B (d×q, b_sq) -> p×q
+    template <typename DerivedA, typename DerivedB>
+    Eigen::MatrixXd kernelBlock(const Eigen::MatrixBase<DerivedA>& A, const Eigen::VectorXd& a_sq,
+                                const Eigen::MatrixBase<DerivedB>& B, const Eigen::VectorXd& b_sq) const;
+    void appendNode(const Eigen::VectorXd& x, double y, double score);
+    void removeNode(Eigen::Index idx);
+    void rebuildFactor();   // 从头分解 (加载后 / 数值异常时)
+    void updateAlpha();
+    void pruneLeastInformative();
+    void setHyperParams(const GPHyperParams& params);   // 同时刷新 w_ 与 x_sq_
+
+    Eigen::Index n_ = 0;        // 当前支撑点数
+    Eigen::Index dim_ = 0;      // 特征维度 (第一次 learn 时确定)
+    Eigen::MatrixXd X_;         // d × (max_nodes + 1)，仅前 n_ 列有效
+    Eigen::VectorXd x_sq_;      // 每列的加权平方范数 ||x||²_W
+    Eigen::VectorXd y_;         // 观测值
+    Eigen::VectorXd score_;     // 加入时的 surprise
+    Eigen::MatrixXd L_;         // 下三角，仅左上 n×n 有效 (按 max_nodes + 1 预分配)
+    Eigen::VectorXd alpha_;     // (K + σ²I)⁻¹ y
+    Eigen::VectorXd q_diag_;    // diag((K + σ²I)⁻¹)，增量维护
+    size_t max_nodes_;
+    size_t updates_since_rebuild_ = 0;   // 增量更新次数，累积到 max_nodes 后重新分解以消除舍入漂移
+    uint64_t data_version_ = 0;
+    GPHyperParams hyper_;
+    Eigen::VectorXd w_;         // 1 / len_scales²
 };
 
 } // namespace titan::memory
\ No newline at end of file
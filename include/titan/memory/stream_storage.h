@@ -0,0 +1,304 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "nlohmann_json/json.hpp"
+
+// CognitiveStream 的底层存储原语：
+//   - PhraseTable:  重复短语驻留 (标签、固定描述只存一份，按 ID 引用)
+//   - EventArena:   FIFO 环形字节池，事件正文与明细按写入顺序分配/释放
+//   - DetailWriter: 紧凑二进制明细记录，需要时再渲染成 JSON
+namespace titan::memory {
+
+using json = nlohmann::json;
+
+using PhraseId = uint32_t;
+constexpr PhraseId NO_PHRASE = 0xFFFFFFFFu;
+
+// --- 1. 短语驻留表 ---
+// 只增不减；适用于取值集合有限的字符串 (检测类别、状态描述、JSON key)。
+// 查找用 string_view，命中时零分配。
+class PhraseTable {
+private:
+    std::deque<std::string> phrases_; // deque 保证元素地址稳定，index_ 的 key 指向这里
+    std::unordered_map<std::string_view, PhraseId> index_;
+
+public:
+    PhraseId intern(std::string_view text) {
+        auto it = index_.find(text);
+        if (it != index_.end()) return it->second;
+
+        PhraseId id = static_cast<PhraseId>(phrases_.size());
+        phrases_.emplace_back(text);
+        index_.emplace(phrases_.back(), id);
+        return id;
+    }
+
+    std::string_view view(PhraseId id) const {
+        if (id >= phrases_.size()) return {};
+        return phrases_[id];
+    }
+
+    size_t size() const { return phrases_.size(); }
+};
+
+// --- 2. 环形字节池 ---
+// 事件按时间顺序写入、按时间顺序淘汰，因此只需要 head/tail 两个游标。
+// 分配失败时由调用方淘汰最旧事件后重试；每个块都是连续的 (放不下时跳到开头，尾部空隙随淘汰回收)。
+class EventArena {
+private:
+    std::vector<char> buf_;
+    size_t head_ = 0;    // 下一次写入位置
+    size_t tail_ = 0;    // 最旧存活块的起点
+    bool empty_ = true;
+
+public:
+    explicit EventArena(size_t bytes) : buf_(bytes > 0 ? bytes : 1) {}
+
+    size_t capacity() const { return buf_.size(); }
+
+    std::optional<uint32_t> allocate(size_t n) {
+        if (n > buf_.size()) return std::nullopt;
+        if (empty_) {
+            head_ = tail_ = 0;
+        }
+        size_t off;
+        if (empty_ || head_ > tail_) {
+            if (head_ + n <= buf_.size()) off = head_;
+            else if (n <= tail_) off = 0;              // 绕回开头
+            else return std::nullopt;
+        } else {
+            // 已绕回: 可用空间是 [head_, tail_)
+            if (head_ + n > tail_) return std::nullopt;
+            off = head_;
+        }
+        head_ = off + n;
+        empty_ = false;
+        return static_cast<uint32_t>(off);
+    }
+
+    // 最旧事件被淘汰后，把 tail 推进到新的最旧块起点
+    void releaseUntil(uint32_t new_tail) { tail_ = new_tail; }
+
+    // 撤销最近一次分配 (off 为它的起点，且之后没有再分配)，用于改写最新一条事件
+    void rewindTo(uint32_t off) { head_ = off; }
+
+    void reset() { head_ = tail_ = 0; empty_ = true; }
+
+    char* data(uint32_t off) { return buf_.data() + off; }
+    const char* data(uint32_t off) const { return buf_.data() + off; }
+};
+
+// --- 3. 紧凑二进制明细 ---
+// 自描述的 tag 流，结构与 JSON 同构；key 与短字符串枚举值走 PhraseTable。
+// 一条明细至少 1 个字节 (NIL)，这样每个事件块都非空，EventArena 的游标不会歧义。
+enum class DetailTag : uint8_t {
+    NIL = 0,
+    OBJECT_BEGIN,
+    OBJECT_END,
+    ARRAY_BEGIN,
+    ARRAY_END,
+    KEY,        // + u32 PhraseId
+    INT,        // + i64
+    REAL,       // + f64
+    BOOL,       // + u8
+    PHRASE,     // + u32 PhraseId (驻留字符串)
+    STRING,     // + u32 长度 + 原始字节
+    KEY_STRING  // + u32 长度 + 原始字节 (内联 key，用于脱离 PhraseTable 的持久化记录)
+};
+
+class DetailWriter {
+private:
+    std::vector<uint8_t>& out_;
+
+    void tag(DetailTag t) { out_.push_back(static_cast<uint8_t>(t)); }
+
+    template <typename T>
+    void raw(T v) {
+        size_t pos = out_.size();
+        out_.resize(pos + sizeof(T));
+        std::memcpy(out_.data() + pos, &v, sizeof(T));
+    }
+
+public:
+    // 复用调用方的缓冲区 (capacity 保留，稳态下不分配)
+    explicit DetailWriter(std::vector<uint8_t>& out) : out_(out) { out_.clear(); }
+
+    void null() { tag(DetailTag::NIL); }
+    void beginObject() { tag(DetailTag::OBJECT_BEGIN); }
+    void endObject() { tag(DetailTag::OBJECT_END); }
+    void beginArray() { tag(DetailTag::ARRAY_BEGIN); }
+    void endArray() { tag(DetailTag::ARRAY_END); }
+    void key(PhraseId k) { tag(DetailTag::KEY); raw<uint32_t>(k); }
+    void value(int64_t v) { tag(DetailTag::INT); raw<int64_t>(v); }
+    void value(double v) { tag(DetailTag::REAL); raw<double>(v); }
+    void value(bool v) { tag(DetailTag::BOOL); raw<uint8_t>(v ? 1 : 0); }
+    void phrase(PhraseId p) { tag(DetailTag::PHRASE); raw<uint32_t>(p); }
+    void string(std::string_view s) {
+        tag(DetailTag::STRING);
+        raw<uint32_t>(static_cast<uint32_t>(s.size()));
+        out_.insert(out_.end(), s.begin(), s.end());
+    }
+
+    // 通用路径：把外部传入的 JSON 转成二进制明细 (key 驻留，字符串值内联)
+    void encode(const json& j, PhraseTable& phrases) {
+        switch (j.type()) {
+            case json::value_t::object:
+                beginObject();
+                for (auto it = j.begin(); it != j.end(); ++it) {
+                    key(phrases.intern(it.key()));
+                    encode(it.value(), phrases);
+                }
+                endObject();
+                break;
+            case json::value_t::array:
+                beginArray();
+                for (const auto& v : j) encode(v, phrases);
+                endArray();
+                break;
+            case json::value_t::string:
+                string(j.get_ref<const std::string&>());
+                break;
+            case json::value_t::boolean:
+                value(j.get<bool>());
+                break;
+            case json::value_t::number_integer:
+            case json::value_t::number_unsigned:
+                value(j.get<int64_t>());
+                break;
+            case json::value_t::number_float:
+                value(j.get<double>());
+                break;
+            default:
+                null();
+        }
+    }
+};
+
+// 二进制明细 -> JSON (仅在复盘/调试等冷路径调用)
+class DetailReader {
+private:
+    const uint8_t* p_;
+    const uint8_t* end_;
+    const PhraseTable& phrases_;
+
+    template <typename T>
+    T raw() {
+        T v{};
+        if (p_ + sizeof(T) > end_) { p_ = end_; return v; }
+        std::memcpy(&v, p_, sizeof(T));
+        p_ += sizeof(T);
+        return v;
+    }
+
+    DetailTag peek() const { return static_cast<DetailTag>(*p_); }
+
+public:
+    DetailReader(const void* data, size_t len, const PhraseTable& phrases)
+        : p_(static_cast<const uint8_t*>(data)), end_(p_ + len), phrases_(phrases) {}
+
+    json read() {
+        if (p_ >= end_) return nullptr;
+        DetailTag t = static_cast<DetailTag>(*p_++);
+        switch (t) {
+            case DetailTag::OBJECT_BEGIN: {
+                json obj = json::object();
+                while (p_ < end_ && peek() != DetailTag::OBJECT_END) {
+                    DetailTag kt = static_cast<DetailTag>(*p_++);
+                    std::string k;
+                    if (kt == DetailTag::KEY) {
+                        k = phrases_.view(raw<uint32_t>());
+                    } else if (kt == DetailTag::KEY_STRING) {
+                        uint32_t n = raw<uint32_t>();
+                        if (p_ + n > end_) n = static_cast<uint32_t>(end_ - p_);
+                        k.assign(reinterpret_cast<const char*>(p_), n);
+                        p_ += n;
+                    } else {
+                        break;
+                    }
+                    obj[k] = read();
+                }
+                if (p_ < end_) ++p_;
+                return obj;
+            }
+            case DetailTag::ARRAY_BEGIN: {
+                json arr = json::array();
+                while (p_ < end_ && peek() != DetailTag::ARRAY_END) arr.push_back(read());
+                if (p_ < end_) ++p_;
+                return arr;
+            }
+            case DetailTag::INT: return raw<int64_t>();
+            case DetailTag::REAL: return raw<double>();
+            case DetailTag::BOOL: return raw<uint8_t>() != 0;
+            case DetailTag::PHRASE: return std::string(phrases_.view(raw<uint32_t>()));
+            case DetailTag::STRING: {
+                uint32_t n = raw<uint32_t>();
+                if (p_ + n > end_) n = static_cast<uint32_t>(end_ - p_);
+                std::string s(reinterpret_cast<const char*>(p_), n);
+                p_ += n;
+                return s;
+            }
+            default: return nullptr;
+        }
+    }
+};
+
+// 把明细中的 KEY / PHRASE 引用展开成内联字符串，得到不依赖 PhraseTable 的自包含记录
+// (写盘用；out 由调用方复用)
+inline void inlinePhrases(const uint8_t* in, size_t len, const PhraseTable& phrases, std::vector<uint8_t>& out) {
+    out.clear();
+    const uint8_t* p = in;
+    const uint8_t* end = in + len;
+    auto put = [&out](const void* src, size_t n) {
+        const uint8_t* b = static_cast<const uint8_t*>(src);
+        out.insert(out.end(), b, b + n);
+    };
+    while (p < end) {
+        DetailTag t = static_cast<DetailTag>(*p++);
+        switch (t) {
+            case DetailTag::KEY:
+            case DetailTag::PHRASE: {
+                if (p + 4 > end) return;
+                uint32_t id;
+                std::memcpy(&id, p, 4);
+                p += 4;
+                std::string_view text = phrases.view(id);
+                uint32_t n = static_cast<uint32_t>(text.size());
+                out.push_back(static_cast<uint8_t>(t == DetailTag::KEY ? DetailTag::KEY_STRING : DetailTag::STRING));
+                put(&n, 4);
+                put(text.data(), n);
+                break;
+            }
+            case DetailTag::INT:
+            case DetailTag::REAL:
+            case DetailTag::BOOL: {
+                size_t n = t == DetailTag::BOOL ? 1 : 8;
+                if (p + n > end) return;
+                out.push_back(static_cast<uint8_t>(t));
+                put(p, n);
+                p += n;
+                break;
+            }
+            case DetailTag::STRING:
+            case DetailTag::KEY_STRING: {
+                if (p + 4 > end) return;
+                uint32_t n;
+                std::memcpy(&n, p, 4);
+                if (p + 4 + n > end) return;
+                out.push_back(static_cast<uint8_t>(t));
+                put(p, 4 + n);
+                p += 4 + n;
+                break;
+            }
+            default:
+                out.push_back(static_cast<uint8_t>(t));
+        }
+    }
+}
+
+} // namespace titan::memory
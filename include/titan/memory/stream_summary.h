@@ -0,0 +1,162 @@
+#pragma once
+#include "titan/core/types.h"
+#include "titan/core/ring_buffer.h"
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace titan::memory {
+
+// 粗略的 token 估算 (英文平均约 4 字符 / token)，只用于预算裁剪
+constexpr size_t CHARS_PER_TOKEN = 4;
+inline size_t estimateTokens(std::string_view text) {
+    return (text.size() + CHARS_PER_TOKEN - 1) / CHARS_PER_TOKEN;
+}
+
+// 被压缩掉的一段时间的摘要
+struct TierSummary {
+    static constexpr size_t MAX_HIGHLIGHTS = 3;
+    static constexpr size_t EVENT_TYPE_COUNT = 7;
+
+    titan::core::TimePoint begin;
+    titan::core::TimePoint end;
+    uint32_t count = 0;                                   // 折叠的原始事件数 (含合并的重复)
+    std::array<uint32_t, EVENT_TYPE_COUNT> per_type{};
+    std::array<std::string, MAX_HIGHLIGHTS> highlights;   // 重要事件摘录，按时间顺序
+    size_t highlight_count = 0;
+
+    void addHighlight(std::string_view text) {
+        if (highlight_count == MAX_HIGHLIGHTS) {
+            // 只保留最近的几条
+            for (size_t i = 1; i < MAX_HIGHLIGHTS; ++i) highlights[i - 1].swap(highlights[i]);
+            --highlight_count;
+        }
+        highlights[highlight_count++].assign(text);
+    }
+
+    // 把更晚的一段并入自身 (minute -> hour)
+    void absorb(const TierSummary& later) {
+        if (count == 0) begin = later.begin;
+        end = later.end;
+        count += later.count;
+        for (size_t i = 0; i < EVENT_TYPE_COUNT; ++i) per_type[i] += later.per_type[i];
+        for (size_t i = 0; i < later.highlight_count; ++i) addHighlight(later.highlights[i]);
+    }
+
+    void reset() {
+        count = 0;
+        per_type.fill(0);
+        highlight_count = 0;
+    }
+};
+
+// 分层滚动摘要: 被挤出事件窗口的事件先折叠进当前分钟，
+// 分钟层满了再折叠进小时层，而不是直接丢弃。
+class StreamSummarizer {
+public:
+    static constexpr size_t MINUTE_TIER_SIZE = 60;
+    static constexpr size_t HOUR_TIER_SIZE = 24;
+
+private:
+    titan::core::TimePoint origin_;
+    titan::core::FixedRing<TierSummary> minutes_{MINUTE_TIER_SIZE};
+    titan::core::FixedRing<TierSummary> hours_{HOUR_TIER_SIZE};
+    TierSummary open_minute_;
+    TierSummary open_hour_;
+    uint64_t revision_ = 0;
+
+    // 重要性: 用户指令、决策、本体状态变化会被摘录；常规视觉/思考只计数
+    static bool isNotable(titan::core::EventType type) {
+        return type == titan::core::EventType::PERCEPTION_AUDIO ||
+               type == titan::core::EventType::DECISION_SWITCH ||
+               type == titan::core::EventType::PERCEPTION_BODY;
+    }
+
+    void closeMinute() {
+        if (open_minute_.count == 0) return;
+        if (minutes_.full()) {
+            const TierSummary& oldest = minutes_.front();
+            if (open_hour_.count > 0 &&
+                oldest.end - open_hour_.begin >= std::chrono::hours(1)) {
+                hours_.push_back() = open_hour_;
+                open_hour_.reset();
+            }
+            open_hour_.absorb(oldest);
+            minutes_.pop_front();
+        }
+        minutes_.push_back() = open_minute_;
+        open_minute_.reset();
+    }
+
+    void renderLine(const TierSummary& s, std::string& out) const {
+        using namespace std::chrono;
+        auto from = duration_cast<minutes>(s.begin - origin_).count();
+        auto to = duration_cast<minutes>(s.end - origin_).count() + 1;
+        out += "[T+" + std::to_string(from) + "m.." + std::to_string(to) + "m] ";
+        out += std::to_string(s.count) + " events (";
+        bool first = true;
+        for (size_t i = 0; i < TierSummary::EVENT_TYPE_COUNT; ++i) {
+            if (s.per_type[i] == 0) continue;
+            if (!first) out += ", ";
+            out += titan::core::eventTypeTag(static_cast<titan::core::EventType>(i));
+            out += " x" + std::to_string(s.per_type[i]);
+            first = false;
+        }
+        out += ")";
+        for (size_t i = 0; i < s.highlight_count; ++i) {
+            out += i == 0 ? "; notable: " : " | ";
+            out += s.highlights[i];
+        }
+        out += "\n";
+    }
+
+public:
+    StreamSummarizer() : origin_(std::chrono::steady_clock::now()) {}
+
+    // 每次内容变化递增，供调用方判断渲染缓存是否过期
+    uint64_t revision() const { return revision_; }
+    bool empty() const { return open_minute_.count == 0 && minutes_.empty() && open_hour_.count == 0 && hours_.empty(); }
+
+    void fold(titan::core::TimePoint t, titan::core::EventType type, uint32_t repeat, std::string_view summary) {
+        if (open_minute_.count > 0 && t - open_minute_.begin >= std::chrono::minutes(1)) closeMinute();
+        if (open_minute_.count == 0) open_minute_.begin = t;
+        open_minute_.end = t;
+        open_minute_.count += repeat;
+        open_minute_.per_type[static_cast<size_t>(type)] += repeat;
+        if (isNotable(type)) open_minute_.addHighlight(summary);
+        ++revision_;
+    }
+
+    // 按时间顺序输出摘要行；超出 max_chars 时优先丢弃最旧的行
+    void render(std::string& out, size_t max_chars) const {
+        std::vector<const TierSummary*> tiers;
+        tiers.reserve(hours_.size() + minutes_.size() + 2);
+        for (size_t i = 0; i < hours_.size(); ++i) tiers.push_back(&hours_[i]);
+        if (open_hour_.count > 0) tiers.push_back(&open_hour_);
+        for (size_t i = 0; i < minutes_.size(); ++i) tiers.push_back(&minutes_[i]);
+        if (open_minute_.count > 0) tiers.push_back(&open_minute_);
+
+        std::vector<std::string> lines(tiers.size());
+        size_t used = 0;
+        size_t first = tiers.size();
+        while (first > 0) {
+            std::string& line = lines[first - 1];
+            renderLine(*tiers[first - 1], line);
+            if (used + line.size() > max_chars) break;
+            used += line.size();
+            --first;
+        }
+        for (size_t i = first; i < lines.size(); ++i) out += lines[i];
+    }
+
+    void clear() {
+        minutes_.clear();
+        hours_.clear();
+        open_minute_.reset();
+        open_hour_.reset();
+        ++revision_;
+    }
+};
+
+} // namespace titan::memory
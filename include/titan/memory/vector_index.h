@@ -0,0 +1,356 @@
+#pragma once
+#include "quantized_store.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <vector>
+
+namespace titan::memory {
+
+// Embedding 向量索引 (余弦相似度)
+//
+// 向量入库时归一化，相似度 = 点积；向量编码由 QuantizedStore 连续存放 (fp32 / int8 / PQ)，
+// 行宽补齐到 8 的倍数，扫描时没有尾部分支，也不需要每次重新计算范数。
+//   - 精确模式: SIMD 全量 (或子集) 扫描 + 大小为 k 的最小堆
+//   - HNSW 模式: 数据量超过 hnsw_threshold 后由调用方在后台建图 (buildGraph + installGraph)，之后增量插入，近似 top-k
+// 量化存储且保留了 fp32 原始向量时，先按编码取 k * rerank_factor 个候选，再精确重排。
+//
+// 每行附带一个 64 位 label，由调用方自行编码 (例如 实体ID + 事件序号)。
+// 线程模型: 单写者；写入期间不能并发查询，查询之间可以并发 (访问标记是 thread_local 的)。
+//   建图/PQ 训练都分两步: buildGraph()/trainCodebook() 是 const 的，可以与查询并发 (耗时都在这里)；
+//   installGraph()/installCodebook() 是写入，只做交换和补齐。
+class VectorIndex {
+public:
+    static constexpr uint32_t NPOS = 0xFFFFFFFFu;
+
+    struct Options {
+        size_t hnsw_threshold = 20000;   // 行数超过该值时 graphDue() (0 = 从不建图，始终精确扫描)
+        size_t M = 16;                   // 上层每个节点的最大邻居数 (第 0 层为 2M)
+        size_t ef_construction = 128;
+        size_t ef_search = 64;
+        QuantizedStore::Options storage;
+        size_t rerank_factor = 8;        // 仅在 storage.keep_full_precision 时生效
+    };
+
+    struct Hit {
+        uint32_t row;
+        uint64_t label;
+        float score;
+    };
+
+    // 可选的行过滤器 (作用域限定，例如只要某个实体的事件)
+    using Filter = std::function<bool(uint64_t label)>;
+
+    // HNSW 图；links[row][level] 是该节点在这一层的邻居
+    struct Graph {
+        std::vector<std::vector<std::vector<uint32_t>>> links;
+        uint32_t entry = NPOS;
+        int max_level = -1;
+        std::mt19937 rng{0x7174a9u};
+    };
+
+private:
+    Options opts_;
+    QuantizedStore store_;
+    std::vector<uint64_t> labels_;
+
+    Graph graph_;
+    bool graph_built_ = false;
+
+    using Scored = std::pair<float, uint32_t>;   // (相似度, 行号)
+
+    using Query = QuantizedStore::Query;
+
+    float score(const Query& q, uint32_t r) const { return store_.score(q, r); }
+
+    // 查询预处理到 thread_local 缓冲 (稳态不分配)
+    const Query* prepareQuery(const std::vector<float>& query) const {
+        thread_local Query q;
+        return store_.prepare(query, q) ? &q : nullptr;
+    }
+
+    // 粗排候选数: 需要重排时多取一些
+    size_t candidateCount(size_t k) const {
+        return store_.hasFullPrecision() && store_.mode() != Quantization::FP32 ? k * std::max<size_t>(opts_.rerank_factor, 1) : k;
+    }
+
+    // 最小堆维护 top-k
+    static void pushTopK(std::vector<Scored>& heap, size_t k, float s, uint32_t r) {
+        auto cmp = std::greater<Scored>();
+        if (heap.size() < k) {
+            heap.emplace_back(s, r);
+            std::push_heap(heap.begin(), heap.end(), cmp);
+        } else if (s > heap.front().first) {
+            std::pop_heap(heap.begin(), heap.end(), cmp);
+            heap.back() = {s, r};
+            std::push_heap(heap.begin(), heap.end(), cmp);
+        }
+    }
+
+    std::vector<Hit> finish(std::vector<Scored>& heap, size_t k, float min_score, const Query& q) const {
+        if (candidateCount(k) > k) {
+            for (auto& [s, r] : heap) s = store_.exactScore(q, r);
+        }
+        std::sort(heap.begin(), heap.end(), std::greater<Scored>());
+        if (heap.size() > k) heap.resize(k);
+        std::vector<Hit> out;
+        out.reserve(heap.size());
+        for (const auto& [s, r] : heap) {
+            if (s < min_score) break;
+            out.push_back({r, labels_[r], s});
+        }
+        return out;
+    }
+
+    // 访问标记: 按代计数，避免每次查询清零整张表
+    struct Visited {
+        std::vector<uint32_t> marks;
+        uint32_t tag = 0;
+
+        void reset(size_t n) {
+            if (marks.size() < n) marks.resize(n, 0);
+            if (++tag == 0) {
+                std::fill(marks.begin(), marks.end(), 0);
+                tag = 1;
+            }
+        }
+        bool visit(uint32_t r) {
+            if (marks[r] == tag) return false;
+            marks[r] = tag;
+            return true;
+        }
+    };
+
+    static Visited& visitedScratch() {
+        thread_local Visited v;
+        return v;
+    }
+
+    size_t maxLinks(int level) const { return level == 0 ? opts_.M * 2 : opts_.M; }
+
+    int randomLevel(Graph& g) const {
+        std::uniform_real_distribution<double> uni(std::nextafter(0.0, 1.0), 1.0);
+        double mult = 1.0 / std::log(static_cast<double>(std::max<size_t>(opts_.M, 2)));
+        return static_cast<int>(-std::log(uni(g.rng)) * mult);
+    }
+
+    // 单层贪心 (ef = 1)，用于从顶层下降
+    uint32_t greedyClosest(const Graph& g, const Query& q, uint32_t ep, int level) const {
+        float best = score(q, ep);
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (uint32_t n : g.links[ep][level]) {
+                float s = score(q, n);
+                if (s > best) {
+                    best = s;
+                    ep = n;
+                    changed = true;
+                }
+            }
+        }
+        return ep;
+    }
+
+    // 单层 beam search；返回的候选按相似度降序。
+    // filter 只影响结果集，不影响图遍历 (不通过的节点仍然作为跳板)。
+    std::vector<Scored> searchLayer(const Graph& g, const Query& q, uint32_t ep, size_t ef, int level,
+                                    const Filter* filter = nullptr) const {
+        Visited& visited = visitedScratch();
+        visited.reset(labels_.size());
+
+        std::priority_queue<Scored> frontier;   // 最大堆: 待扩展，最相似的先出
+        std::vector<Scored> results;            // 最小堆: 当前最好的 ef 个
+        auto cmp = std::greater<Scored>();
+
+        float s0 = score(q, ep);
+        visited.visit(ep);
+        frontier.emplace(s0, ep);
+        if (!filter || (*filter)(labels_[ep])) results.emplace_back(s0, ep);
+
+        // 过滤模式下结果集凑不满 ef 时会继续向外扩展，直到找够或走完可达节点
+        while (!frontier.empty()) {
+            auto [s, r] = frontier.top();
+            if (results.size() >= ef && s < results.front().first) break;
+            frontier.pop();
+
+            for (uint32_t n : g.links[r][level]) {
+                if (!visited.visit(n)) continue;
+                float sn = score(q, n);
+                if (results.size() >= ef && sn <= results.front().first) continue;
+                frontier.emplace(sn, n);
+                if (filter && !(*filter)(labels_[n])) continue;
+                results.emplace_back(sn, n);
+                std::push_heap(results.begin(), results.end(), cmp);
+                if (results.size() > ef) {
+                    std::pop_heap(results.begin(), results.end(), cmp);
+                    results.pop_back();
+                }
+            }
+        }
+        std::sort(results.begin(), results.end(), std::greater<Scored>());
+        return results;
+    }
+
+    // 启发式选邻居: 候选只有在离查询点比离所有已选邻居都近时才保留，保持图的连通性与方向多样性
+    std::vector<uint32_t> selectNeighbors(const std::vector<Scored>& candidates, size_t m) const {
+        std::vector<uint32_t> chosen;
+        chosen.reserve(m);
+        for (const auto& [s, c] : candidates) {
+            if (chosen.size() >= m) break;
+            bool keep = true;
+            for (uint32_t o : chosen) {
+                if (store_.similarity(c, o) > s) {
+                    keep = false;
+                    break;
+                }
+            }
+            if (keep) chosen.push_back(c);
+        }
+        return chosen;
+    }
+
+    void shrinkLinks(Graph& g, uint32_t node, int level) const {
+        auto& nb = g.links[node][level];
+        size_t cap = maxLinks(level);
+        if (nb.size() <= cap) return;
+        std::vector<Scored> cand;
+        cand.reserve(nb.size());
+        for (uint32_t n : nb) cand.emplace_back(store_.similarity(node, n), n);
+        std::sort(cand.begin(), cand.end(), std::greater<Scored>());
+        nb = selectNeighbors(cand, cap);
+    }
+
+    void insertIntoGraph(Graph& g, uint32_t r) const {
+        int level = randomLevel(g);
+        g.links[r].assign(level + 1, {});
+
+        if (g.entry == NPOS) {
+            g.entry = r;
+            g.max_level = level;
+            return;
+        }
+
+        Query q;
+        store_.prepareStored(r, q);
+        uint32_t ep = g.entry;
+        for (int l = g.max_level; l > level; --l) ep = greedyClosest(g, q, ep, l);
+
+        for (int l = std::min(level, g.max_level); l >= 0; --l) {
+            auto candidates = searchLayer(g, q, ep, opts_.ef_construction, l);
+            g.links[r][l] = selectNeighbors(candidates, opts_.M);
+            for (uint32_t n : g.links[r][l]) {
+                g.links[n][l].push_back(r);
+                shrinkLinks(g, n, l);
+            }
+            if (!candidates.empty()) ep = candidates.front().second;
+        }
+
+        if (level > g.max_level) {
+            g.max_level = level;
+            g.entry = r;
+        }
+    }
+
+public:
+    VectorIndex() = default;
+    explicit VectorIndex(const Options& opts) : opts_(opts), store_(opts.storage) {}
+
+    size_t size() const { return labels_.size(); }
+    size_t dim() const { return store_.dim(); }
+    size_t bytesPerVector() const { return store_.bytesPerVector(); }
+    bool hasGraph() const { return graph_built_; }
+    bool graphDue() const { return !graph_built_ && opts_.hnsw_threshold > 0 && labels_.size() >= opts_.hnsw_threshold; }
+    uint64_t label(uint32_t r) const { return labels_[r]; }
+
+    void reserve(size_t rows) {
+        store_.reserve(rows);
+        labels_.reserve(rows);
+    }
+
+    // 插入一条向量，返回行号；维度不一致时拒绝 (返回 NPOS)
+    uint32_t add(const std::vector<float>& vec, uint64_t label) {
+        uint32_t r = store_.add(vec);
+        if (r == QuantizedStore::NPOS) return NPOS;
+        labels_.push_back(label);
+
+        if (graph_built_) {
+            graph_.links.emplace_back();
+            insertIntoGraph(graph_, r);
+        }
+        return r;
+    }
+
+    // PQ 码本训练 (同样两步，转发给存储)
+    bool codebookDue() const { return store_.trainingDue(); }
+    QuantizedStore::Codebook trainCodebook() const { return store_.trainPQ(); }
+    void installCodebook(QuantizedStore::Codebook&& cb) { store_.installPQ(std::move(cb)); }
+
+    // 对当前所有行建图 (耗时)；只读索引，可以与查询并发，不能与写入并发
+    Graph buildGraph() const {
+        Graph g;
+        g.links.resize(labels_.size());
+        for (uint32_t r = 0; r < labels_.size(); ++r) insertIntoGraph(g, r);
+        return g;
+    }
+
+    // 安装 buildGraph() 的结果，并补插建图之后新增的行 (写入)
+    void installGraph(Graph&& g) {
+        graph_ = std::move(g);
+        for (uint32_t r = static_cast<uint32_t>(graph_.links.size()); r < labels_.size(); ++r) {
+            graph_.links.emplace_back();
+            insertIntoGraph(graph_, r);
+        }
+        graph_built_ = true;
+    }
+
+    // 精确 top-k (量化存储时为编码上的精确扫描)；rows 非空时只扫描这些行 (作用域检索)
+    std::vector<Hit> searchExact(const std::vector<float>& query, size_t k, float min_score = -1.f,
+                                 const std::vector<uint32_t>* rows = nullptr) const {
+        if (k == 0 || labels_.empty()) return {};
+        const Query* q = prepareQuery(query);
+        if (!q) return {};
+
+        size_t n = candidateCount(k);
+        std::vector<Scored> heap;
+        heap.reserve(n + 1);
+        if (rows) {
+            for (uint32_t r : *rows) pushTopK(heap, n, score(*q, r), r);
+        } else {
+            for (uint32_t r = 0; r < labels_.size(); ++r) pushTopK(heap, n, score(*q, r), r);
+        }
+        return finish(heap, k, min_score, *q);
+    }
+
+    // 近似 top-k (未建图时退化为精确扫描)；filter 限定结果的作用域
+    std::vector<Hit> search(const std::vector<float>& query, size_t k, float min_score = -1.f,
+                            const Filter* filter = nullptr, size_t ef = 0) const {
+        if (k == 0 || labels_.empty()) return {};
+        if (!graph_built_ && !filter) return searchExact(query, k, min_score);
+        const Query* q = prepareQuery(query);
+        if (!q) return {};
+
+        size_t n = candidateCount(k);
+        if (!graph_built_) {
+            std::vector<Scored> heap;
+            heap.reserve(n + 1);
+            for (uint32_t r = 0; r < labels_.size(); ++r) {
+                if ((*filter)(labels_[r])) pushTopK(heap, n, score(*q, r), r);
+            }
+            return finish(heap, k, min_score, *q);
+        }
+
+        uint32_t ep = graph_.entry;
+        for (int l = graph_.max_level; l > 0; --l) ep = greedyClosest(graph_, *q, ep, l);
+
+        auto candidates = searchLayer(graph_, *q, ep, std::max({ef, opts_.ef_search, n}), 0, filter);
+        if (candidates.size() > n) candidates.resize(n);
+        return finish(candidates, k, min_score, *q);
+    }
+};
+
+} // namespace titan::memory
@@ -4,12 +4,16 @@
 #include "titan/cognition/object_cognition.h"
 #include "titan/memory/cognitive_stream.h"
 #include "titan/learning/strategy_optimizer.h"
+#include "titan/learning/reflection_worker.h"
 #include "titan/agent/multi_task_executive.h"
 #include "titan/agent/behavior_arbiter.h"
 #include "titan/control/fep_controller.h"
+#include "titan/control/control_loop.h"
 #include "hal/tts_engine.h"
 #include "titan/control/action_manager.h"
 #include "titan/cognition/scene_memory.h" // 确保包含
+#include "titan/core/task_graph.h"
+#include <cstdio>
 #include <iostream>
 #include <future>
 
@@ -26,23 +30,52 @@ public:
     ObjectCognitionEngine cognition_engine_;
     
     titan::memory::CognitiveStream stream_;
+    titan::memory::EpisodeLog episode_log_{episodeLogOptions()};
     titan::learning::StrategyOptimizer learner_;
+    titan::learning::ReflectionWorker reflector_{learner_};   // 必须在 learner_ 之后声明 (先于它析构)
     
     MultiTaskExecutive multi_executive_;
     AttentionEngine attention_sys_;
     BehaviorArbiter arbiter_;
+    ProposalSet proposals_;   // 每个 tick 复用，不重新分配
     
     control::FEPController controller_;
     control::ActionManager action_mgr_;
+    // 必须在 controller_ / action_mgr_ 之后声明: 析构时先停内环，再销毁它调用的对象
+    control::ControlLoop control_loop_{controller_, controlLoopOptions()};
     hal::TTSEngine tts_engine_;
     titan::cognition::SceneMemoryEngine scene_memory_engine_;    
 
+    // --- tick 帧数据 ---
+    // 任务图各节点之间通过这些固定槽位交换数据，每个槽位只有一个写者节点
+    struct TickFrame {
+        TimePoint now;
+        FusedContext ctx;
+        std::vector<VisualDetection> raw_dets;
+        std::string focus_target;
+        double pred_error = 0.0;
+        bool has_active_task = false;
+        std::vector<AttentionalObject> saliency;   // 探索提案按指针捕获其中的元素，有效期到下一个 tick
+        ActionProposal safety, executive, exploration;
+    };
+    TickFrame frame_;
+
+    static constexpr std::chrono::seconds TICK_STATS_INTERVAL{10};
+    TimePoint last_tick_report_{};
+
+    // 必须最后声明: 析构时先停工作线程，再销毁节点访问的子系统
+    // 图最宽处 3 个节点并行 (body / cognition / propose_safety)，调用线程算其中一个
+    titan::core::TaskGraph tick_graph_{titan::core::TaskGraph::suggestedWorkers(3)};
+
     // --- 构造函数 ---
     TitanAgentImpl() : action_mgr_(nullptr) { 
-        // 1. 绑定 StrategyOptimizer
+        // 1. 绑定 StrategyOptimizer (从磁盘恢复之前学到的策略)
+        learner_.attachStore(titan::learning::StrategyStore::Options{});
         multi_executive_.injectStrategyOptimizer(&learner_);
         
-        // 2. 绑定 CognitiveStream
+        // 2. 绑定 CognitiveStream (规划 Prompt 中的认知流限制在 1k token 内)
+        stream_.setTokenBudget(1024);
+        stream_.attachEpisodeLog(&episode_log_);
         multi_executive_.injectMemoryStream(&stream_);
         
         // 3. [新增] 绑定 ActionManager (注意：action_mgr_ 需要先初始化)
@@ -51,20 +84,93 @@ public:
 
         // 4. [新增] 绑定 SceneMemory
         multi_executive_.injectSceneMemory(&scene_memory_engine_);
+
+        // 5. 行为切换代价: 打断任务执行会让动作重新规划，打断好奇心探索几乎没有损失
+        arbiter_.setPreemptionCost(internSource("Executive"), 1.0);
+        arbiter_.setPreemptionCost(internSource("Exploration"), 0.2);
+
+        // 6. 启动 1 kHz 内环 (与 100 Hz 认知 tick 解耦)；行为指令与 FEP 力输出都经 ActionManager 在内环中下发
+        const double dt = std::chrono::duration<double>(control_loop_.period()).count();
+        control_loop_.setCycleHook([this, dt](const control::ControlLoop::Output& out) {
+            action_mgr_.controlCycle(dt, {out.force, out.velocity_limit, out.active});
+        });
+        control_loop_.start();
+
+        // 7. tick 各阶段的依赖图 (构建一次，每个 tick 执行一遍)
+        buildTickGraph();
+    }
+
+    // 日志保留: 每个 session 最多 8 x 16 MB，目录中保留最近 4 个 session (磁盘上限约 512 MB)
+    static titan::memory::EpisodeLog::Options episodeLogOptions() {
+        titan::memory::EpisodeLog::Options opts;
+        opts.max_segment_bytes = 16ull << 20;
+        opts.max_segments = 8;
+        opts.max_sessions = 4;
+        return opts;
+    }
+
+    static control::ControlLoop::Options controlLoopOptions() {
+        control::ControlLoop::Options opts;
+        opts.rt.fifo_priority = 80;   // 没有 CAP_SYS_NICE 时退化为普通线程并记录日志
+        return opts;
     }
 
     // --- 核心心跳函数 (The Heartbeat) ---
     void tick() {
-        auto now = std::chrono::steady_clock::now();
-        
+        frame_.now = std::chrono::steady_clock::now();
+
+        // 1.1 获取时空对齐的上下文 (非阻塞)；所有阶段都依赖它，在图外串行执行
+        frame_.ctx = perception_.getContext(frame_.now);
+
+        // Phase 1 ~ 4: 按依赖关系并行执行，全部完成后返回
+        tick_graph_.run();
+
         // =========================================================
-        // Phase 1: 感知对齐与注入 (Perception Alignment & Injection)
+        // Phase 5: 仲裁与并行输出 (Arbitration & Output)
         // =========================================================
-        
-        // 1.1 获取时空对齐的上下文 (非阻塞)
-        FusedContext ctx = perception_.getContext(now);
 
-        // 1.2 自身状态检查 (Meta-Cognition)
+        // 固定顺序收集提案 (与各节点的完成顺序无关，同分时的仲裁结果保持确定)
+        proposals_.clear();
+        proposals_.push(std::move(frame_.safety));       // A. 安全反射 (Reflex) - 最高优先级
+        proposals_.push(std::move(frame_.executive));    // B. 任务执行 (Cognitive) - 基于 Executive 状态
+        proposals_.push(std::move(frame_.exploration));  // C. 好奇心探索 (Curiosity) - 基于注意力
+
+        // 5.1 赢家通吃 (Winner-Take-All)，赢家的 execute() 在 arbitrate 内执行
+        arbiter_.arbitrate(proposals_, frame_.now);
+
+        reportTickStats(frame_.now);
+    }
+
+    // --- tick 任务图 ---
+    //
+    //   body ──> stream_audio ──┐
+    //   cognition ──────────────┴──> stream_visual ──> executive ──┬──> propose_executive
+    //        └─────────────────────────────────────────────────────┴──> attention ──> propose_exploration
+    //   propose_safety
+    //
+    // 写 stream_ 的节点 (stream_audio -> stream_visual -> executive) 串成一条链，事件写入顺序与串行版本一致；
+    // body 与 stream_audio 都会写内环设定点 (setSetpoint / STOP 时 hold)，所以也串行。
+    void buildTickGraph() {
+        auto& g = tick_graph_;
+        auto body = g.add("body", [this] { phaseBody(); });
+        auto audio = g.add("stream_audio", [this] { phaseStreamInjection(); }, {body});
+        auto world = g.add("cognition", [this] { phaseWorldModel(); });
+        g.add("propose_safety", [this] { frame_.safety = proposeSafety(frame_.ctx); });
+        auto visual = g.add("stream_visual", [this] { phaseVisualStream(); }, {audio, world});
+        auto exec = g.add("executive", [this] { phaseExecutive(); }, {visual});
+        auto attention = g.add("attention", [this] { phaseAttention(); }, {world, exec});
+        g.add("propose_executive",
+              [this] { frame_.executive = multi_executive_.getBestProposal(frame_.ctx, cognition_engine_); }, {exec});
+        g.add("propose_exploration", [this] { frame_.exploration = proposeExploration(frame_.saliency); }, {attention});
+    }
+
+    // =========================================================
+    // Phase 1: 感知对齐与注入 (Perception Alignment & Injection)
+    // =========================================================
+
+    // 1.2 自身状态检查 (Meta-Cognition)
+    void phaseBody() {
+        const FusedContext& ctx = frame_.ctx;
         // [闭环控制] 如果视觉糊了，立即抑制运动增益
         if (ctx.vision.has_value() && ctx.vision->quality == FrameQuality::BLURRY) {
             controller_.reduceGainForStability(); 
@@ -72,9 +178,16 @@ public:
             controller_.updateInternalState(); // 尝试恢复增益
         }
 
+        // 内环设定点: 只写邮箱，内环线程每毫秒读取最新值。
+        // 没有本体驱动 (仿真) 时力输出无处可去，内环保持 hold，只推进 ActionManager，不做 FEP 求解
+        if (action_mgr_.hasDriver() && ctx.robot.joint_pos.size() > 0) control_loop_.setSetpoint(ctx.robot.joint_pos);
+    }
+
+    void phaseStreamInjection() {
+        const FusedContext& ctx = frame_.ctx;
+
         // 1.3 认知流注入 (Stream Injection)
-        // 将"瞬时信号"转化为"历史事件"
-        stream_.addVisualContext(ctx);
+        // 将"瞬时信号"转化为"历史事件" (视觉内容在 Phase 2 之后按实体变化注入)
         stream_.addSystemStatus(ctx.system_status);
 
         // 1.4 音频处理 (带自我抑制机制)
@@ -91,93 +204,102 @@ public:
                 onUserCommand(user_text);
             }
         }
+    }
 
-        // =========================================================
-        // Phase 2: 世界模型更新 (World Modeling)
-        // =========================================================
-        
-        // 将 2D 检测框升级为 3D 实体 (Object Permanence)
-        std::vector<VisualDetection> raw_dets;
-        if (ctx.vision.has_value()) {
+    // =========================================================
+    // Phase 2: 世界模型更新 (World Modeling)
+    // =========================================================
+
+    // 将 2D 检测框升级为 3D 实体 (Object Permanence)
+    void phaseWorldModel() {
+        auto& raw_dets = frame_.raw_dets;   // 跨 tick 复用容量
+        raw_dets.clear();
+        if (frame_.ctx.vision.has_value()) {
             // 适配层：将 VisualFrame::Detection 转为 VisualDetection
-            for(const auto& d : ctx.vision->detections) {
+            for(const auto& d : frame_.ctx.vision->detections) {
                 VisualDetection vd; 
                 vd.label = d.label; vd.box = d.box; vd.confidence = d.confidence;
                 // vd.mask = d.mask; // 如果有mask
                 raw_dets.push_back(vd);
             }
         }
-        cognition_engine_.update(raw_dets, now);
+        cognition_engine_.update(raw_dets, frame_.now);
+    }
 
-        // =========================================================
-        // Phase 3: 战略与任务调度 (Strategic & Executive)
-        // =========================================================
+    // 视觉事件只在实体出现 / 消失 / 运动状态变化时写入认知流 (带限流)
+    void phaseVisualStream() {
+        auto tracked_entities = cognition_engine_.getAllEntitiesPtrs();
+        stream_.addVisualContext(frame_.ctx, &tracked_entities);
+    }
 
+    // =========================================================
+    // Phase 3: 战略与任务调度 (Strategic & Executive)
+    // =========================================================
+
+    void phaseExecutive() {
         // 3.1 多任务管家更新 (包含 LLM 异步规划结果的检查)
         // 这里会进行任务切换、步骤推进、预期生成
-        multi_executive_.update(ctx, cognition_engine_);
+        multi_executive_.update(frame_.ctx, cognition_engine_);
 
         // 3.2 学习闭环 (Learning Loop)
         // 检查是否有任务刚刚完成或失败
         auto finished_task = multi_executive_.popFinishedTask();
         if (finished_task) {
-            bool success{false};
+            bool success = (finished_task->status == TaskStatus::COMPLETED);
             // [异步] 触发反思学习，总结策略
-            // 不阻塞 tick，放在后台线程跑
-            std::thread([this, task = *finished_task, &success]() {
-                success = (task.status == TaskStatus::COMPLETED);
-                learner_.reflectOnEpisode(stream_.getHistory(), success);
-            }).detach();
+            // tick 线程只交出日志范围快照，回放在反思线程池上进行；后台线程不碰 stream_
+            if (auto range = stream_.episodeRange()) {
+                reflector_.submit(std::move(*range), success, std::move(finished_task->applied_strategies));
+            } else {
+                reflector_.submit(std::string(stream_.transcriptView()), success, std::move(finished_task->applied_strategies));   // 没有日志: 退化为当前窗口
+            }
             
             // 语音反馈
             performBehavior(EventType::ACTION_VERBAL, 
                 success ? "Task complete." : "Task failed, I am learning from this.");
         }
 
-        // =========================================================
-        // Phase 4: 注意力与竞价 (Attention & Bidding)
-        // =========================================================
+        // 4.1 / 4.2 下游节点需要的 Executive 状态在这里取快照，
+        // 注意力节点与 propose_executive 并行时不再读 multi_executive_
+        frame_.focus_target = multi_executive_.getTopDownTarget();
+        frame_.pred_error = multi_executive_.getCurrentPredictionError();
+        frame_.has_active_task = multi_executive_.hasActiveTask();
+    }
 
-        // 4.1 获取 Top-Down 目标
-        std::string focus_target = multi_executive_.getTopDownTarget();
-        
-        // 4.2 获取预测误差 (惊奇度)
-        // 如果 Executive 在执行中发现预期不符 (Prediction Error)，注入注意力
-        double pred_error = multi_executive_.getCurrentPredictionError();
+    // =========================================================
+    // Phase 4: 注意力与竞价 (Attention & Bidding)
+    // =========================================================
+
+    void phaseAttention() {
+        // 4.2 如果 Executive 在执行中发现预期不符 (Prediction Error)，注入注意力
         std::map<std::string, double> surprise_map; 
-        if (!focus_target.empty()) surprise_map[focus_target] = pred_error;
+        if (!frame_.focus_target.empty()) surprise_map[frame_.focus_target] = frame_.pred_error;
 
         // 4.3 计算注意力 (Attention Saliency)
         // 融合了：视觉显著性 + 任务目标 + 惊奇度 + 历史抑制
-        auto saliency_map = attention_sys_.computeSaliency(raw_dets, focus_target, surprise_map);
-
-        // 4.4 行为竞价 (Generating Proposals)
-        std::vector<ActionProposal> proposals;
-        
-        // A. 安全反射 (Reflex) - 最高优先级
-        proposals.push_back(proposeSafety(ctx));
-
-        // B. 任务执行 (Cognitive) - 基于 Executive 状态
-        proposals.push_back(multi_executive_.getBestProposal(ctx, cognition_engine_));
-
-        // C. 好奇心探索 (Curiosity) - 基于注意力
-        proposals.push_back(proposeExploration(saliency_map));
-
-        // =========================================================
-        // Phase 5: 仲裁与并行输出 (Arbitration & Output)
-        // =========================================================
-
-        // 5.1 赢家通吃 (Winner-Take-All)
-        arbiter_.arbitrate(proposals);
+        frame_.saliency = attention_sys_.computeSaliency(frame_.raw_dets, frame_.focus_target, surprise_map);
+    }
 
-        // 5.2 执行赢家逻辑
-        /* 在arbitrate 已经完成执行
-        if (winner.has_value()) {
-            // execute() 内部会调用 performBehavior 或直接控制 controller
-            // 例如：如果是 Task Proposal，它会计算 FEP 并调用 performBehavior
-            winner.value().execute();
+    // 每 TICK_STATS_INTERVAL 输出一次各阶段耗时
+    void reportTickStats(TimePoint now) {
+        if (now - last_tick_report_ < TICK_STATS_INTERVAL) return;
+        last_tick_report_ = now;
+
+        auto s = tick_graph_.stats();
+        char buf[96];
+        std::snprintf(buf, sizeof(buf), "[Tick] graph avg %.0f us, max %.0f us, serial work %.0f us |",
+                      s.avg_wall_us, s.max_wall_us, s.last_work_us);
+        std::string line = buf;
+        for (const auto& n : s.nodes) {
+            std::snprintf(buf, sizeof(buf), " %s %.0f/%.0f", n.name.c_str(), n.avg_us, n.max_us);
+            line += buf;
         }
-        */
+        auto a = arbiter_.stats();
+        std::snprintf(buf, sizeof(buf), " | arbiter %.2f switch/s (safety %llu, held dwell %llu, margin %llu)",
+                      a.switch_rate_hz, static_cast<unsigned long long>(a.safety_overrides),
+                      static_cast<unsigned long long>(a.held_by_dwell), static_cast<unsigned long long>(a.held_by_margin));
+        line += buf;
+        titan::core::AsyncLogger::instance().log(line);
     }
 
     // --- 统一行为接口 (Unified Action Interface) ---
@@ -195,6 +317,7 @@ public:
             // [Motor Channel]
             // 如果 content 是预定义指令
             if (content == "STOP") {
+                control_loop_.hold();
                 action_mgr_.execute(Eigen::VectorXd::Zero(6), "STOP");
             }
             // 注意：复杂的连续控制通常由 FEPController 在 winner.execute() 闭包中直接驱动
@@ -204,8 +327,9 @@ public:
 
     // --- 辅助提案生成器 ---
     ActionProposal proposeSafety(const FusedContext& ctx) {
+        static const SourceId SAFETY_REFLEX = internSource("SafetyReflex");
         ActionProposal p;
-        p.source = "SafetyReflex";
+        p.source = SAFETY_REFLEX;
         p.priority = 0.0;
 
         // 检查：如果手臂堵转，或者外界有急停信号
@@ -221,20 +345,22 @@ public:
     }
 
     ActionProposal proposeExploration(const std::vector<AttentionalObject>& saliency) {
+        static const SourceId EXPLORATION = internSource("Exploration");
         ActionProposal p;
-        p.source = "Exploration";
+        p.source = EXPLORATION;
         p.priority = 0.0;
         
         // 如果当前没任务，且有个东西特别显眼 (Bottom-up score high)
-        if (!multi_executive_.hasActiveTask() && !saliency.empty()) {
+        if (!frame_.has_active_task && !saliency.empty()) {
             const auto& obj = saliency[0];
             if (obj.bottom_up_score > 0.8) {
                 p.priority = 2.0; // 低优先级
-                p.description = "Look at " + obj.raw_det.label;
-                p.execute = [this, obj]() {
+                p.description.format("Look at %s", obj.raw_det.label.c_str());
+                // 提案在本 tick 内仲裁并执行，saliency 此时仍然有效，按指针捕获即可 (不拷贝整个对象)
+                p.execute = [this, target = &obj]() {
                     // 转头看过去 (Mock)
-                    // head_controller_.lookAt(obj.raw_det.box);
-                    performBehavior(EventType::ACTION_PHYSICAL, "LookAt:" + obj.raw_det.label);
+                    // head_controller_.lookAt(target->raw_det.box);
+                    performBehavior(EventType::ACTION_PHYSICAL, "LookAt:" + target->raw_det.label);
                 };
             }
         }
@@ -269,6 +395,7 @@ void TitanAgent::onUserCommand(const std::string& text) {
 void TitanAgent::feedSensors(const titan::core::RobotState& rs, const cv::Mat& img, titan::core::TimePoint t_img) {
     // 假设 Impl 中有 perception_ 成员
     impl_->perception_.onImuJointData(rs);
+    impl_->action_mgr_.observeJointState(rs.joint_pos, rs.joint_vel);
     if (!img.empty()) impl_->perception_.onCameraFrame(img, t_img);
 }
 
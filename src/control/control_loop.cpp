@@ -0,0 +1,90 @@
+#include "titan/control/control_loop.h"
+#include <algorithm>
+
+namespace titan::control {
+
+ControlLoop::ControlLoop(FEPController& controller, const Options& opts) : controller_(controller), opts_(opts) {}
+
+ControlLoop::~ControlLoop() {
+    stop();
+}
+
+void ControlLoop::setCycleHook(CycleHook hook) {
+    if (running()) return;
+    hook_ = std::move(hook);
+}
+
+bool ControlLoop::start() {
+    if (running_.exchange(true, std::memory_order_acq_rel)) return false;
+    worker_ = std::thread(&ControlLoop::loop, this);
+    return true;
+}
+
+void ControlLoop::stop() {
+    running_.store(false, std::memory_order_release);
+    if (worker_.joinable()) worker_.join();
+}
+
+bool ControlLoop::setSetpoint(const Eigen::VectorXd& features) {
+    if (features.size() <= 0 || static_cast<size_t>(features.size()) > MAX_FEATURES) return false;
+    Setpoint sp;
+    sp.dim = static_cast<uint32_t>(features.size());
+    std::copy(features.data(), features.data() + features.size(), sp.features.begin());
+    sp.active = true;
+    setpoint_.store(sp);
+    return true;
+}
+
+void ControlLoop::hold() {
+    setpoint_.store(Setpoint{});
+}
+
+void ControlLoop::loop() {
+    titan::core::configureRealtimeThread(opts_.rt, "ControlLoop");
+
+    // 周期内用到的状态全部预先分配
+    Eigen::VectorXd features(MAX_FEATURES);
+    auto workspace = controller_.makeWorkspace(MAX_FEATURES);
+    Stats stats;
+    double jitter_sum_us = 0.0;
+    double compute_sum_us = 0.0;
+    const double period_us = static_cast<double>(opts_.period.count());
+    uint64_t cycle = 0;
+
+    titan::core::PeriodicTimer timer(opts_.period);
+    while (running_.load(std::memory_order_acquire)) {
+        auto wake = timer.wait();
+        auto started = std::chrono::steady_clock::now();
+
+        Setpoint sp = setpoint_.load();
+        Output out;
+        out.cycle = ++cycle;
+        if (sp.active) {
+            if (features.size() != static_cast<Eigen::Index>(sp.dim)) features.resize(sp.dim);   // 只在维度变化时
+            std::copy(sp.features.begin(), sp.features.begin() + sp.dim, features.data());
+            auto res = controller_.solve(features, workspace);
+            out.force = res.force;
+            out.velocity_limit = res.velocity_limit;
+            out.is_exploring = res.is_exploring;
+            out.active = true;
+        }
+        output_.store(out);
+        if (hook_) hook_(out);
+
+        // --- 抖动 / 超时统计 ---
+        double jitter_us = wake.lateness_ns / 1000.0;
+        double compute_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - started).count();
+        ++stats.cycles;
+        stats.missed_periods += wake.missed;
+        if (jitter_us + compute_us > period_us) ++stats.overruns;
+        jitter_sum_us += jitter_us;
+        compute_sum_us += compute_us;
+        stats.mean_jitter_us = jitter_sum_us / stats.cycles;
+        stats.mean_compute_us = compute_sum_us / stats.cycles;
+        stats.max_jitter_us = std::max(stats.max_jitter_us, jitter_us);
+        stats.max_compute_us = std::max(stats.max_compute_us, compute_us);
+        stats_.store(stats);
+    }
+}
+
+} // namespace titan::control
@@ -1,20 +1,40 @@
 #include "titan/control/fep_controller.h"
+#include "titan/core/async_logger.h"
 #include <iostream>
 #include <cmath>
+#include <tuple>
 
 namespace titan::control {
 
-FEPController::FEPController() {
-    muscle_memory_.load("muscle.bin");
+FEPController::FEPController()
+    : model_(epoch_, std::make_unique<const titan::memory::GPPredictor>()) {
+    if (muscle_memory_.load(MEMORY_PATH)) model_.publish(muscle_memory_.predictor());
+    learner_ = std::thread(&FEPController::learnerLoop, this);
 }
 
 FEPController::~FEPController() {
-    muscle_memory_.save("muscle.bin");
+    {
+        std::lock_guard<std::mutex> lock(sample_mtx_);
+        running_ = false;
+    }
+    sample_cv_.notify_one();
+    if (learner_.joinable()) learner_.join();   // 学习线程会先消化完剩余样本
+    if (dirty_) muscle_memory_.save(MEMORY_PATH);
 }
 
-// 1. 核心计算逻辑
+// 1. 核心计算逻辑 (控制线程: 只读快照，不等待学习)
 FEPController::ControlOutput FEPController::solve(const Eigen::VectorXd& perception_features) {
-    auto [mean, variance] = muscle_memory_.predict(perception_features);
+    thread_local titan::memory::GPPredictor::Workspace ws;
+    return solve(perception_features, ws);
+}
+
+FEPController::ControlOutput FEPController::solve(const Eigen::VectorXd& perception_features,
+                                                  titan::memory::GPPredictor::Workspace& ws) {
+    double mean, variance;
+    {
+        auto model = model_.read();
+        std::tie(mean, variance) = model->predict(perception_features, ws);
+    }
     
     ControlOutput out;
     out.is_exploring = false;
@@ -31,29 +51,98 @@ FEPController::ControlOutput FEPController::solve(const Eigen::VectorXd& percept
     // [关键实现] 应用稳定性因子
     // 如果 stability_factor_ 变小 (e.g. 0.3)，输出力会变柔和
     // 这相当于降低了 PID 控制器中的 Kp (比例增益)
-    out.force = raw_force * stability_factor_;
+    const double stability = stability_factor_.load(std::memory_order_relaxed);
+    out.force = raw_force * stability;
 
     // 同时限制最大速度，防止过冲
     // 假设最大物理速度是 1.0 m/s
-    out.velocity_limit = 1.0 * stability_factor_;
+    out.velocity_limit = 1.0 * stability;
 
     return out;
 }
 
+// 快照的支撑点数不会超过预算 (+1 个换出前的临时节点)，容量在构造 (加载) 后固定
+titan::memory::GPPredictor::Workspace FEPController::makeWorkspace(size_t max_features) const {
+    titan::memory::GPPredictor::Workspace ws;
+    ws.reserve(muscle_memory_.capacity() + 1, max_features);
+    return ws;
+}
+
 void FEPController::learn(const Eigen::VectorXd& features, double actual_best, double pred_val) {
     double surprise = std::abs(actual_best - pred_val);
-    muscle_memory_.learn(features, actual_best, surprise);
+    bool dropped = false;
+    {
+        std::lock_guard<std::mutex> lock(sample_mtx_);
+        if (samples_.size() >= MAX_PENDING_SAMPLES) {
+            samples_.pop_front();
+            dropped = true;
+        }
+        samples_.push_back({features, actual_best, surprise});
+    }
+    sample_cv_.notify_one();
+    if (dropped) titan::core::AsyncLogger::instance().log("[FEP] Learner backlog full, dropped oldest sample");
+}
+
+void FEPController::learnerLoop() {
+    std::deque<Sample> batch;
+    while (true) {
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(sample_mtx_);
+            sample_cv_.wait_for(lock, LEARNER_POLL, [this] { return !samples_.empty() || !running_; });
+            batch.swap(samples_);
+            stopping = !running_;
+        }
+
+        bool changed = !batch.empty();
+        for (const auto& s : batch) muscle_memory_.learn(s.features, s.actual_best, s.surprise);
+        batch.clear();
+        dirty_ |= changed;
+
+        if (auto update = hyper_opt_.take()) {
+            muscle_memory_.applyHyperUpdate(*update);
+            changed = true;
+        }
+
+        maintain(std::chrono::steady_clock::now());
+
+        // 一批样本只发布一次快照；拷贝在学习线程完成，控制线程只做一次原子读。
+        // 发布后立刻回收，不等退休列表攒到 RECLAIM_THRESHOLD
+        if (changed) {
+            model_.publish(muscle_memory_.predictor());
+            epoch_.reclaim();
+        }
+
+        if (stopping) {
+            std::lock_guard<std::mutex> lock(sample_mtx_);
+            if (samples_.empty()) break;
+        }
+    }
+}
+
+void FEPController::maintain(std::chrono::steady_clock::time_point now) {
+    if (now - last_hyper_submit_ >= HYPER_INTERVAL && !hyper_opt_.busy()) {
+        hyper_opt_.submit(muscle_memory_);
+        last_hyper_submit_ = now;
+    }
+
+    // 定期检查点: 崩溃最多丢失 CHECKPOINT_INTERVAL 内学到的经验
+    if (dirty_ && now - last_checkpoint_ >= CHECKPOINT_INTERVAL) {
+        if (muscle_memory_.save(MEMORY_PATH)) dirty_ = false;
+        last_checkpoint_ = now;
+    }
 }
 
 // 2. [快降] 当发现视觉模糊时调用
 void FEPController::reduceGainForStability() {
     // 乘法衰减：每次调用降低 50%，直到下限
     // 这种非线性下降能对连续模糊做出极快反应
-    stability_factor_ *= 0.5;
+    double factor = stability_factor_.load(std::memory_order_relaxed) * 0.5;
     
-    if (stability_factor_ < MIN_STABILITY) {
-        stability_factor_ = MIN_STABILITY;
+    if (factor < MIN_STABILITY) {
+        factor = MIN_STABILITY;
     }
+    stability_factor_.store(factor, std::memory_order_relaxed);
     
     // std::cout << "[Control] Stability compromised. Dropping gain to " << stability_factor_ << std::endl;
 }
@@ -61,9 +150,11 @@ void FEPController::reduceGainForStability() {
 // 3. [慢升] 每帧自动调用
 void FEPController::updateInternalState() {
     // 线性恢复：如果没有外部干扰，慢慢回到 1.0
-    if (stability_factor_ < 1.0) {
-        stability_factor_ += RECOVERY_RATE;
-        if (stability_factor_ > 1.0) stability_factor_ = 1.0;
+    double factor = stability_factor_.load(std::memory_order_relaxed);
+    if (factor < 1.0) {
+        factor += RECOVERY_RATE;
+        if (factor > 1.0) factor = 1.0;
+        stability_factor_.store(factor, std::memory_order_relaxed);
     }
 }
 
@@ -0,0 +1,336 @@
+#include "titan/learning/strategy_store.h"
+#include "titan/core/mapped_file.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace titan::learning {
+
+namespace {
+
+constexpr char SNAP_MAGIC[8] = {'T', 'I', 'T', 'A', 'N', 'S', 'T', 'R'};
+constexpr uint32_t SNAP_VERSION = 1;
+constexpr uint32_t OP_MARKER = 0x50535254; // "TRSP"
+
+#pragma pack(push, 1)
+struct SnapHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_bytes;
+    uint64_t last_seq;    // 快照已包含的最后一个操作序号
+    uint32_t count;
+    int32_t next_id;
+};
+
+struct OpHeader {
+    uint32_t marker;
+    uint8_t op;
+    uint8_t reserved[3];
+    uint64_t seq;
+    int32_t next_id;
+    uint32_t payload_len;
+    uint32_t checksum;    // payload 的 FNV-1a
+};
+#pragma pack(pop)
+
+uint32_t fnv1a(const uint8_t* p, size_t n) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < n; ++i) {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// --- 记录编码: id, usage, success, rule, tags, embedding (小端，定长字段直接 memcpy) ---
+
+template <typename T>
+void put(std::vector<uint8_t>& out, const T& v) {
+    const auto* p = reinterpret_cast<const uint8_t*>(&v);
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+void putString(std::vector<uint8_t>& out, const std::string& s) {
+    put<uint32_t>(out, static_cast<uint32_t>(s.size()));
+    out.insert(out.end(), s.begin(), s.end());
+}
+
+void encodeRecord(std::vector<uint8_t>& out, const StrategyRecord& rec) {
+    put<int32_t>(out, rec.id);
+    put<int32_t>(out, rec.usage_count);
+    put<double>(out, rec.success_rate);
+    putString(out, rec.rule_text);
+    put<uint32_t>(out, static_cast<uint32_t>(rec.tags.size()));
+    for (const auto& tag : rec.tags) putString(out, tag);
+    put<uint32_t>(out, static_cast<uint32_t>(rec.embedding.size()));
+    const auto* e = reinterpret_cast<const uint8_t*>(rec.embedding.data());
+    out.insert(out.end(), e, e + rec.embedding.size() * sizeof(float));
+}
+
+// 带边界检查的顺序读取 (数据来自 mmap 区域)
+class RecordReader {
+private:
+    const uint8_t* p_;
+    const uint8_t* end_;
+    bool ok_ = true;
+
+    bool need(size_t n) {
+        if (!ok_ || static_cast<size_t>(end_ - p_) < n) ok_ = false;
+        return ok_;
+    }
+
+    template <typename T>
+    T get() {
+        T v{};
+        if (need(sizeof(T))) {
+            std::memcpy(&v, p_, sizeof(T));
+            p_ += sizeof(T);
+        }
+        return v;
+    }
+
+    std::string getString() {
+        uint32_t len = get<uint32_t>();
+        if (!need(len)) return {};
+        std::string s(reinterpret_cast<const char*>(p_), len);
+        p_ += len;
+        return s;
+    }
+
+public:
+    RecordReader(const uint8_t* p, size_t n) : p_(p), end_(p + n) {}
+
+    bool ok() const { return ok_; }
+
+    bool read(StrategyRecord& rec) {
+        rec.id = get<int32_t>();
+        rec.usage_count = get<int32_t>();
+        rec.success_rate = get<double>();
+        rec.rule_text = getString();
+        uint32_t tag_count = get<uint32_t>();
+        rec.tags.clear();
+        for (uint32_t i = 0; i < tag_count && ok_; ++i) rec.tags.push_back(getString());
+        uint32_t dim = get<uint32_t>();
+        rec.embedding.clear();
+        if (dim > 0 && need(static_cast<size_t>(dim) * sizeof(float))) {
+            rec.embedding.resize(dim);
+            std::memcpy(rec.embedding.data(), p_, dim * sizeof(float));
+            p_ += dim * sizeof(float);
+        }
+        return ok_;
+    }
+};
+
+void applyOp(std::map<int, StrategyRecord>& db, StrategyOp op, StrategyRecord&& rec) {
+    switch (op) {
+        case StrategyOp::ADD:
+            db[rec.id] = std::move(rec);
+            break;
+        case StrategyOp::MODIFY: {
+            auto it = db.find(rec.id);
+            if (it == db.end()) break;
+            if (rec.embedding.empty()) rec.embedding = std::move(it->second.embedding);
+            it->second = std::move(rec);
+            break;
+        }
+        case StrategyOp::DELETE:
+            db.erase(rec.id);
+            break;
+        case StrategyOp::STATS: {
+            auto it = db.find(rec.id);
+            if (it == db.end()) break;
+            it->second.usage_count = rec.usage_count;
+            it->second.success_rate = rec.success_rate;
+            break;
+        }
+    }
+}
+
+} // namespace
+
+StrategyStore::StrategyStore(const Options& opts) : opts_(opts) {
+    snap_path_ = opts_.dir + "/strategies.snap";
+    log_path_ = opts_.dir + "/strategies.log";
+
+    std::error_code ec;
+    std::filesystem::create_directories(opts_.dir, ec);
+    if (ec) {
+        std::cerr << "[StrategyStore] Cannot create " << opts_.dir << ": " << ec.message() << std::endl;
+        return;
+    }
+    ok_ = true;
+}
+
+StrategyStore::~StrategyStore() {
+    if (log_fd_ >= 0) ::close(log_fd_);
+}
+
+bool StrategyStore::writeAll(int fd, const void* data, size_t len) {
+    const char* p = static_cast<const char*>(data);
+    while (len > 0) {
+        ssize_t n = ::write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "[StrategyStore] Write failed: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        p += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool StrategyStore::openLog(bool truncate) {
+    if (log_fd_ >= 0) ::close(log_fd_);
+    int flags = O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC | (truncate ? O_TRUNC : 0);
+    log_fd_ = ::open(log_path_.c_str(), flags, 0644);
+    if (log_fd_ < 0) {
+        std::cerr << "[StrategyStore] Cannot open " << log_path_ << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+StrategyStore::LoadResult StrategyStore::load() {
+    LoadResult result;
+    if (!ok_) return result;
+
+    std::map<int, StrategyRecord> db;
+    uint64_t snap_seq = 0;
+
+    // 1. 快照
+    titan::core::MappedFile snap;
+    if (snap.open(snap_path_)) {
+        SnapHeader h{};
+        bool valid = snap.size() >= sizeof(h);
+        if (valid) {
+            std::memcpy(&h, snap.data(), sizeof(h));
+            valid = std::memcmp(h.magic, SNAP_MAGIC, sizeof(h.magic)) == 0 && h.version == SNAP_VERSION &&
+                    h.header_bytes >= sizeof(h) && h.header_bytes <= snap.size();
+        }
+        if (valid) {
+            RecordReader reader(snap.data() + h.header_bytes, snap.size() - h.header_bytes);
+            for (uint32_t i = 0; i < h.count; ++i) {
+                StrategyRecord rec;
+                if (!reader.read(rec)) break;
+                int id = rec.id;
+                db[id] = std::move(rec);
+            }
+            if (!reader.ok()) std::cerr << "[StrategyStore] Snapshot truncated, loaded " << db.size() << " entries" << std::endl;
+            snap_seq = h.last_seq;
+            result.next_id = h.next_id;
+        } else {
+            std::cerr << "[StrategyStore] Ignoring invalid snapshot " << snap_path_ << std::endl;
+        }
+    }
+    last_seq_ = snap_seq;
+
+    // 2. 日志重放 (遇到损坏 / 未写完的尾部即停止，并在重新打开时截掉)
+    size_t valid_end = 0;
+    titan::core::MappedFile log;
+    if (log.open(log_path_)) {
+        size_t offset = 0;
+        while (offset + sizeof(OpHeader) <= log.size()) {
+            OpHeader h;
+            std::memcpy(&h, log.data() + offset, sizeof(h));
+            if (h.marker != OP_MARKER) break;
+            if (offset + sizeof(h) + h.payload_len > log.size()) break;
+            const uint8_t* payload = log.data() + offset + sizeof(h);
+            if (fnv1a(payload, h.payload_len) != h.checksum) break;
+
+            offset += sizeof(h) + h.payload_len;
+            valid_end = offset;
+            ++log_ops_;
+            if (h.seq <= snap_seq) continue;   // 压缩后未来得及截断的旧操作
+
+            StrategyRecord rec;
+            RecordReader reader(payload, h.payload_len);
+            if (!reader.read(rec)) break;
+            applyOp(db, static_cast<StrategyOp>(h.op), std::move(rec));
+            result.next_id = std::max(result.next_id, static_cast<int>(h.next_id));
+            last_seq_ = h.seq;
+            ++result.replayed_ops;
+        }
+        if (valid_end < log.size()) {
+            std::cerr << "[StrategyStore] Dropping " << (log.size() - valid_end) << " trailing bytes of " << log_path_ << std::endl;
+        }
+    }
+    log.close();
+
+    if (openLog(false) && ::ftruncate(log_fd_, static_cast<off_t>(valid_end)) != 0) {
+        std::cerr << "[StrategyStore] Cannot truncate " << log_path_ << ": " << std::strerror(errno) << std::endl;
+    }
+
+    result.records.reserve(db.size());
+    for (auto& [id, rec] : db) {
+        result.next_id = std::max(result.next_id, id + 1);
+        result.records.push_back(std::move(rec));
+    }
+    return result;
+}
+
+void StrategyStore::append(StrategyOp op, const StrategyRecord& rec, int next_id) {
+    if (log_fd_ < 0) return;
+
+    buffer_.clear();
+    buffer_.resize(sizeof(OpHeader));
+    encodeRecord(buffer_, rec);
+
+    OpHeader h{};
+    h.marker = OP_MARKER;
+    h.op = static_cast<uint8_t>(op);
+    h.seq = ++last_seq_;
+    h.next_id = next_id;
+    h.payload_len = static_cast<uint32_t>(buffer_.size() - sizeof(OpHeader));
+    h.checksum = fnv1a(buffer_.data() + sizeof(OpHeader), h.payload_len);
+    std::memcpy(buffer_.data(), &h, sizeof(h));
+
+    if (!writeAll(log_fd_, buffer_.data(), buffer_.size())) return;
+    if (opts_.sync) ::fdatasync(log_fd_);
+    ++log_ops_;
+}
+
+bool StrategyStore::compact(const std::vector<StrategyRecord>& records, int next_id) {
+    if (!ok_) return false;
+
+    buffer_.clear();
+    buffer_.resize(sizeof(SnapHeader));
+    for (const auto& rec : records) encodeRecord(buffer_, rec);
+
+    SnapHeader h{};
+    std::memcpy(h.magic, SNAP_MAGIC, sizeof(h.magic));
+    h.version = SNAP_VERSION;
+    h.header_bytes = sizeof(SnapHeader);
+    h.last_seq = last_seq_;
+    h.count = static_cast<uint32_t>(records.size());
+    h.next_id = next_id;
+    std::memcpy(buffer_.data(), &h, sizeof(h));
+
+    // 先写临时文件再 rename，读者永远只看到完整的旧快照或新快照
+    std::string tmp_path = snap_path_ + ".tmp";
+    int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "[StrategyStore] Cannot open " << tmp_path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    bool written = writeAll(fd, buffer_.data(), buffer_.size());
+    if (written && opts_.sync) written = ::fsync(fd) == 0;
+    ::close(fd);
+    if (!written || ::rename(tmp_path.c_str(), snap_path_.c_str()) != 0) {
+        std::cerr << "[StrategyStore] Snapshot failed: " << std::strerror(errno) << std::endl;
+        ::unlink(tmp_path.c_str());
+        return false;
+    }
+
+    // 快照已包含全部操作，日志可以清空
+    if (!openLog(true)) return false;
+    log_ops_ = 0;
+    return true;
+}
+
+} // namespace titan::learning
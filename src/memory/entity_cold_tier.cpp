@@ -0,0 +1,391 @@
+#include "titan/memory/entity_cold_tier.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace titan::memory {
+
+namespace {
+
+json toColdRecord(const EntityEvent& evt) {
+    return {
+        {"t", std::chrono::duration_cast<std::chrono::nanoseconds>(evt.timestamp.time_since_epoch()).count()},
+        {"id", evt.event_id},
+        {"d", evt.description},
+        {"a", evt.action_type},
+        {"r", evt.related_entity_ids}
+    };
+}
+
+EntityEvent fromColdRecord(const json& j) {
+    EntityEvent evt;
+    evt.timestamp = TimePoint(std::chrono::duration_cast<TimePoint::duration>(
+        std::chrono::nanoseconds(j.value("t", int64_t{0}))));
+    evt.event_id = j.value("id", "");
+    evt.description = j.value("d", "");
+    evt.action_type = j.value("a", "");
+    evt.related_entity_ids = j.value("r", std::vector<int>{});
+    return evt;
+}
+
+std::string formatTime(TimePoint t) {
+    std::time_t tt = std::chrono::system_clock::to_time_t(t);
+    std::tm tm{};
+    localtime_r(&tt, &tm);
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M", &tm);
+    return buf;
+}
+
+bool writeAll(int fd, const void* data, size_t len) {
+    const char* p = static_cast<const char*>(data);
+    while (len > 0) {
+        ssize_t n = ::write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool readAll(int fd, void* data, size_t len, uint64_t offset) {
+    char* p = static_cast<char*>(data);
+    while (len > 0) {
+        ssize_t n = ::pread(fd, p, len, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+// 读 offset 处的一条记录 (长度头 + msgpack)，失败返回 discarded
+json readRecord(int fd, uint64_t offset, std::vector<uint8_t>& buf) {
+    uint32_t len = 0;
+    if (!readAll(fd, &len, sizeof(len), offset)) return json(json::value_t::discarded);
+    buf.resize(len);
+    if (!readAll(fd, buf.data(), len, offset + sizeof(len))) return json(json::value_t::discarded);
+    return json::from_msgpack(buf, true, false);
+}
+
+// 把 src 从 offset 起的尾部拷贝到 dst (截断重写)
+bool copyTail(const std::string& src, uint64_t offset, uint64_t end, const std::string& dst) {
+    int in = ::open(src.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) return false;
+    int out = ::open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out < 0) {
+        ::close(in);
+        return false;
+    }
+    std::vector<char> buf(64 * 1024);
+    bool ok = true;
+    while (ok && offset < end) {
+        size_t chunk = static_cast<size_t>(std::min<uint64_t>(buf.size(), end - offset));
+        ok = readAll(in, buf.data(), chunk, offset) && writeAll(out, buf.data(), chunk);
+        offset += chunk;
+    }
+    ::close(in);
+    if (::close(out) != 0) ok = false;
+    if (!ok) ::unlink(dst.c_str());
+    return ok;
+}
+
+// entity_<id>.log -> id
+bool parseEntityFile(const std::string& name, int& id) {
+    static const std::string prefix = "entity_", suffix = ".log";
+    if (name.size() <= prefix.size() + suffix.size() || name.compare(0, prefix.size(), prefix) != 0 ||
+        name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+        return false;
+    }
+    std::string digits = name.substr(prefix.size(), name.size() - prefix.size() - suffix.size());
+    char* end = nullptr;
+    errno = 0;
+    long v = std::strtol(digits.c_str(), &end, 10);
+    if (errno != 0 || end != digits.c_str() + digits.size()) return false;
+    id = static_cast<int>(v);
+    return true;
+}
+
+} // namespace
+
+// --- 滚动摘要 ---
+
+void EntityColdTier::SummaryState::fold(const EntityEvent& evt) {
+    if (folded == 0) first = evt.timestamp;
+    last = evt.timestamp;
+    ++folded;
+    if (!evt.action_type.empty()) ++action_counts[evt.action_type];
+    if (!evt.description.empty()) {
+        recent.push_back(evt.description);
+        if (recent.size() > MAX_RECENT) recent.pop_front();
+    }
+}
+
+// 确定性的统计摘要 (不做语义压缩，同样的折叠序列总是得到同样的文本):
+//   事件总数与时间跨度、出现最多的 5 种动作及次数 (次数相同按名字排序)、最近折叠的 MAX_RECENT 条描述
+std::string EntityColdTier::SummaryState::render() const {
+    std::vector<std::pair<std::string, uint32_t>> actions(action_counts.begin(), action_counts.end());
+    std::sort(actions.begin(), actions.end(), [](const auto& a, const auto& b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+
+    std::string out = "Earlier history (" + std::to_string(folded) + " events, " +
+                      formatTime(first) + " - " + formatTime(last) + ")";
+    for (size_t i = 0; i < actions.size() && i < 5; ++i) {
+        out += i == 0 ? ": " : ", ";
+        out += actions[i].first + " x" + std::to_string(actions[i].second);
+    }
+    out += ".";
+    for (size_t i = 0; i < recent.size(); ++i) {
+        out += i == 0 ? " Last archived: " : "; ";
+        out += recent[i];
+    }
+    return out;
+}
+
+// --- 冷层 ---
+
+EntityColdTier::EntityColdTier(const std::string& dir) : dir_(dir) {
+    std::error_code ec;
+    std::filesystem::create_directories(dir_, ec);
+    if (ec) std::cerr << "[EntityColdTier] Cannot create " << dir_ << ": " << ec.message() << std::endl;
+    worker_ = std::thread(&EntityColdTier::workerLoop, this);
+}
+
+EntityColdTier::~EntityColdTier() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (worker_.joinable()) worker_.join();
+}
+
+std::string EntityColdTier::pathFor(int entity_id) const {
+    return dir_ + "/entity_" + std::to_string(entity_id) + ".log";
+}
+
+void EntityColdTier::enqueue(int entity_id, uint64_t seq, std::shared_ptr<const EntityEvent> evt) {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        queue_.push_back({entity_id, seq, std::move(evt)});
+    }
+    cv_.notify_one();
+}
+
+std::optional<EntityEvent> EntityColdTier::load(int entity_id, uint64_t seq) const {
+    uint64_t offset = 0;
+    uint64_t skip = 0;
+    int fd = -1;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = index_.find(entity_id);
+        const ColdIndex* idx = it != index_.end() ? &it->second : nullptr;
+        if (idx && seq >= idx->first_seq && seq - idx->first_seq < idx->count) {
+            uint64_t rel = seq - idx->first_seq;
+            offset = idx->checkpoints[rel / INDEX_STRIDE];
+            skip = rel % INDEX_STRIDE;
+            // 与偏移表在同一临界区内打开: 压缩在 mtx_ 下 rename 并改写偏移，两者不会错位
+            fd = ::open(pathFor(entity_id).c_str(), O_RDONLY | O_CLOEXEC);
+        } else {
+            for (const auto* q : {&batch_, &queue_}) {
+                for (const auto& p : *q) {
+                    if (p.entity_id == entity_id && p.seq == seq) return *p.evt;
+                }
+            }
+            return std::nullopt;
+        }
+    }
+    if (fd < 0) return std::nullopt;
+
+    // 从检查点顺序跳过前面的记录 (只读长度头)
+    bool ok = true;
+    for (; ok && skip > 0; --skip) {
+        uint32_t len = 0;
+        ok = readAll(fd, &len, sizeof(len), offset);
+        offset += sizeof(len) + len;
+    }
+    std::vector<uint8_t> buf;
+    json j = ok ? readRecord(fd, offset, buf) : json(json::value_t::discarded);
+    ::close(fd);
+    if (j.is_discarded()) return std::nullopt;
+    return fromColdRecord(j);
+}
+
+std::vector<std::pair<int, std::string>> EntityColdTier::takeSummaries() {
+    std::vector<std::pair<int, std::string>> out;
+    std::lock_guard<std::mutex> lock(mtx_);
+    out.reserve(ready_summaries_.size());
+    for (auto& [id, text] : ready_summaries_) out.emplace_back(id, std::move(text));
+    ready_summaries_.clear();
+    return out;
+}
+
+void EntityColdTier::drain() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    drained_cv_.wait(lock, [this] { return (!reloading_ && queue_.empty() && batch_.empty()) || !running_; });
+}
+
+void EntityColdTier::reloadExisting() {
+    std::error_code ec;
+    std::vector<uint8_t> buf;
+    for (const auto& entry : std::filesystem::directory_iterator(dir_, ec)) {
+        int id = 0;
+        if (!entry.is_regular_file(ec) || !parseEntityFile(entry.path().filename().string(), id)) continue;
+        std::string path = pathFor(id);
+
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) continue;
+        off_t size = ::lseek(fd, 0, SEEK_END);
+        std::vector<uint64_t> offsets;
+        uint64_t end = 0;
+        while (end < static_cast<uint64_t>(std::max<off_t>(size, 0))) {
+            json j = readRecord(fd, end, buf);
+            if (j.is_discarded()) break;   // 上次运行写到一半的尾部
+            summaries_[id].fold(fromColdRecord(j));
+            offsets.push_back(end);
+            end += sizeof(uint32_t) + buf.size();
+        }
+        ::close(fd);
+
+        // 截掉损坏的尾部和超出 MAX_RECORDS 的最老记录
+        uint64_t begin = offsets.size() > MAX_RECORDS ? offsets[offsets.size() - MAX_RECORDS] : 0;
+        if (begin > 0 || end < static_cast<uint64_t>(size)) {
+            std::string tmp = path + ".tmp";
+            if (!copyTail(path, begin, end, tmp) || ::rename(tmp.c_str(), path.c_str()) != 0) {
+                std::cerr << "[EntityColdTier] Cannot compact " << path << ": " << std::strerror(errno) << std::endl;
+            }
+        }
+        if (summaries_[id].folded == 0) continue;
+
+        std::string text = summaries_[id].render();
+        std::lock_guard<std::mutex> lock(mtx_);
+        ready_summaries_[id] = std::move(text);
+    }
+}
+
+void EntityColdTier::compact(int entity_id) {
+    // index_ 只有本线程写，无锁读取安全
+    const ColdIndex& cur = index_.at(entity_id);
+    if (cur.count <= MAX_RECORDS) return;
+    size_t drop = (cur.count - MAX_RECORDS + INDEX_STRIDE - 1) / INDEX_STRIDE;   // 丢弃的检查点段数
+    uint64_t cut = cur.checkpoints[drop];
+    std::string path = pathFor(entity_id);
+    std::string tmp = path + ".tmp";
+    if (!copyTail(path, cut, cur.file_bytes, tmp)) {
+        std::cerr << "[EntityColdTier] Cannot compact " << path << ": " << std::strerror(errno) << std::endl;
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::cerr << "[EntityColdTier] Cannot compact " << path << ": " << std::strerror(errno) << std::endl;
+        ::unlink(tmp.c_str());
+        return;
+    }
+    ColdIndex& idx = index_[entity_id];
+    idx.checkpoints.erase(idx.checkpoints.begin(), idx.checkpoints.begin() + static_cast<std::ptrdiff_t>(drop));
+    for (auto& off : idx.checkpoints) off -= cut;
+    idx.first_seq += drop * INDEX_STRIDE;
+    idx.count -= drop * INDEX_STRIDE;
+    idx.file_bytes -= cut;
+}
+
+void EntityColdTier::workerLoop() {
+    reloadExisting();
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        reloading_ = false;
+    }
+    drained_cv_.notify_all();
+
+    std::vector<uint8_t> bytes;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            cv_.wait(lock, [this] { return !queue_.empty() || !running_; });
+            if (queue_.empty()) break;   // 停止且队列已空
+            batch_.swap(queue_);
+        }
+
+        // 按实体分组追加写盘 (batch_ 内同一实体的 seq 已按序)
+        std::unordered_map<int, std::vector<std::pair<uint64_t, uint64_t>>> written; // entity -> (seq, offset)
+        std::unordered_map<int, uint64_t> file_end;
+        std::unordered_map<int, int> fds;
+        for (const auto& p : batch_) {
+            auto fit = fds.find(p.entity_id);
+            if (fit == fds.end()) {
+                int fd = ::open(pathFor(p.entity_id).c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+                if (fd < 0) {
+                    std::cerr << "[EntityColdTier] Cannot open " << pathFor(p.entity_id) << ": "
+                              << std::strerror(errno) << std::endl;
+                }
+                fit = fds.emplace(p.entity_id, fd).first;
+                // index_ 只有本线程写，这里无锁读取是安全的；首次打开时文件里可能还有上次运行留下的记录
+                auto iit = index_.find(p.entity_id);
+                off_t end = fd >= 0 ? ::lseek(fd, 0, SEEK_END) : 0;
+                file_end[p.entity_id] = iit != index_.end() ? iit->second.file_bytes
+                                                             : static_cast<uint64_t>(std::max<off_t>(end, 0));
+            }
+
+            summaries_[p.entity_id].fold(*p.evt);
+            if (fit->second < 0) continue;
+
+            bytes.clear();
+            json::to_msgpack(toColdRecord(*p.evt), bytes);
+            uint32_t len = static_cast<uint32_t>(bytes.size());
+            if (!writeAll(fit->second, &len, sizeof(len)) || !writeAll(fit->second, bytes.data(), bytes.size())) {
+                std::cerr << "[EntityColdTier] Write failed: " << std::strerror(errno) << std::endl;
+                continue;
+            }
+            uint64_t& end = file_end[p.entity_id];
+            written[p.entity_id].emplace_back(p.seq, end);
+            end += sizeof(len) + len;
+        }
+        for (auto& [id, fd] : fds) {
+            if (fd >= 0) ::close(fd);
+        }
+
+        std::unordered_map<int, std::string> rendered;
+        for (const auto& [id, _] : fds) rendered[id] = summaries_[id].render();
+
+        std::vector<int> to_compact;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            for (auto& [id, entries] : written) {
+                ColdIndex& idx = index_[id];
+                for (const auto& [seq, off] : entries) {
+                    // 检查点之间靠顺序跳过定位，要求序号连续；写失败留下空洞后，该实体后续的冷事件不再可回读
+                    if (idx.count == 0) idx.first_seq = seq;
+                    if (idx.broken || seq != idx.first_seq + idx.count) {
+                        idx.broken = true;
+                        break;
+                    }
+                    if (idx.count % INDEX_STRIDE == 0) idx.checkpoints.push_back(off);
+                    ++idx.count;
+                }
+                idx.file_bytes = file_end[id];
+                if (idx.count > MAX_RECORDS + COMPACT_SLACK) to_compact.push_back(id);
+            }
+            for (auto& [id, text] : rendered) ready_summaries_[id] = std::move(text);
+            batch_.clear();
+        }
+        // 压缩在清空 batch_ 之后: 被丢弃的记录已经落盘并折叠进摘要
+        for (int id : to_compact) compact(id);
+        drained_cv_.notify_all();
+    }
+    drained_cv_.notify_all();
+}
+
+} // namespace titan::memory
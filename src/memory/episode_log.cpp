@@ -0,0 +1,418 @@
+#include "titan/memory/episode_log.h"
+#include "titan/memory/stream_storage.h"
+#include "titan/core/mapped_file.h"
+#include "titan/core/async_logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace titan::memory {
+
+namespace {
+
+constexpr char SEGMENT_MAGIC[8] = {'T', 'I', 'T', 'A', 'N', 'L', 'O', 'G'};
+constexpr uint32_t SEGMENT_VERSION = 1;
+constexpr uint32_t RECORD_MARKER = 0x43455254; // "TREC"
+
+#pragma pack(push, 1)
+struct SegmentHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_bytes;
+    int64_t wall_ns;      // 打开段时的墙钟时间，离线分析时用来换算 steady 时间戳
+    int64_t steady_ns;    // 同一时刻的 steady_clock
+    uint64_t first_seq;
+};
+
+struct RecordHeader {
+    uint32_t marker;
+    uint8_t type;
+    uint8_t reserved[3];
+    uint32_t text_len;
+    uint32_t detail_len;
+    int64_t steady_ns;
+    uint64_t seq;
+};
+#pragma pack(pop)
+
+int64_t toNs(titan::core::TimePoint t) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+}
+
+titan::core::TimePoint fromNs(int64_t ns) {
+    return titan::core::TimePoint(std::chrono::duration_cast<titan::core::TimePoint::duration>(
+        std::chrono::nanoseconds(ns)));
+}
+
+// 从 offset 开始顺序扫描一个已映射的段，返回回放条数
+size_t scanRecords(const uint8_t* data, size_t size, size_t offset, int64_t from_ns, int64_t to_ns,
+                   const std::function<void(const LoggedEvent&)>& fn) {
+    size_t count = 0;
+    while (offset + sizeof(RecordHeader) <= size) {
+        RecordHeader h;
+        std::memcpy(&h, data + offset, sizeof(h));
+        if (h.marker != RECORD_MARKER) break;   // 损坏或未写完
+        size_t payload = static_cast<size_t>(h.text_len) + h.detail_len;
+        if (offset + sizeof(h) + payload > size) break;
+        if (h.steady_ns > to_ns) break;
+
+        if (h.steady_ns >= from_ns) {
+            const uint8_t* p = data + offset + sizeof(h);
+            LoggedEvent evt;
+            evt.timestamp = fromNs(h.steady_ns);
+            evt.type = static_cast<titan::core::EventType>(h.type);
+            evt.seq = h.seq;
+            evt.summary = std::string_view(reinterpret_cast<const char*>(p), h.text_len);
+            evt.detail = p + h.text_len;
+            evt.detail_len = h.detail_len;
+            fn(evt);
+            ++count;
+        }
+        offset += sizeof(h) + payload;
+    }
+    return count;
+}
+
+} // namespace
+
+json LoggedEvent::detailJson() const {
+    static const PhraseTable EMPTY_PHRASES; // 落盘的明细已内联所有短语
+    return DetailReader(detail, detail_len, EMPTY_PHRASES).read();
+}
+
+titan::core::CognitiveEvent LoggedEvent::toCognitiveEvent() const {
+    titan::core::CognitiveEvent evt;
+    evt.timestamp = timestamp;
+    evt.type = type;
+    evt.summary = std::string(summary);
+    evt.detailed_data = detailJson();
+    return evt;
+}
+
+EpisodeLog::EpisodeLog(const Options& opts) : opts_(opts) {
+    auto wall = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    session_ = "session-" + std::to_string(wall) + "-" + std::to_string(::getpid());
+    buffer_.reserve(opts_.buffer_bytes + 1024);
+
+    std::error_code ec;
+    std::filesystem::create_directories(opts_.dir, ec);
+    if (ec) {
+        std::cerr << "[EpisodeLog] Cannot create " << opts_.dir << ": " << ec.message() << std::endl;
+        return;
+    }
+    pruneSessions();
+
+    // 第一个段在构造时同步打开 (此时写线程还没启动)，以便 isOpen() 反映目录是否可写
+    Command first = openSegment();
+    open_ = runCommand(first);
+    writer_ = std::thread(&EpisodeLog::writerLoop, this);
+}
+
+// 删除目录中最旧的 session，为本 session 留出一个名额。
+// session 名为 "session-<启动墙钟秒>-<pid>"，按启动时间排序
+void EpisodeLog::pruneSessions() {
+    if (opts_.max_sessions == 0) return;
+    namespace fs = std::filesystem;
+
+    std::map<std::pair<long long, std::string>, std::vector<fs::path>> sessions;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(opts_.dir, ec)) {
+        std::string name = entry.path().filename().string();
+        size_t us = name.rfind('_');
+        if (name.compare(0, 8, "session-") != 0 || us == std::string::npos) continue;
+        std::string session = name.substr(0, us);
+        long long started = std::atoll(session.c_str() + 8);
+        sessions[{started, session}].push_back(entry.path());
+    }
+
+    size_t excess = sessions.size() + 1 > opts_.max_sessions ? sessions.size() + 1 - opts_.max_sessions : 0;
+    for (auto it = sessions.begin(); excess > 0 && it != sessions.end(); ++it, --excess) {
+        for (const auto& path : it->second) fs::remove(path, ec);
+        std::cerr << "[EpisodeLog] Retention: removed old session " << it->first.second << std::endl;
+    }
+}
+
+EpisodeLog::~EpisodeLog() {
+    if (open_) closeSegment();
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (writer_.joinable()) writer_.join();
+}
+
+void EpisodeLog::writeAll(int fd, const void* data, size_t len) {
+    const char* p = static_cast<const char*>(data);
+    while (len > 0) {
+        ssize_t n = ::write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "[EpisodeLog] Write failed: " << std::strerror(errno) << std::endl;
+            return;
+        }
+        p += n;
+        len -= static_cast<size_t>(n);
+    }
+}
+
+// 写者线程: 登记新段并返回打开它的命令；超出段数上限的旧段交给写线程删除
+EpisodeLog::Command EpisodeLog::openSegment() {
+    char seq[16];
+    std::snprintf(seq, sizeof(seq), "_%06zu", next_segment_no_++);   // 单调编号: 保留策略删掉旧段后不会重名
+    Segment seg;
+    seg.path = opts_.dir + "/" + session_ + seq + ".tlog";
+
+    Command cmd;
+    cmd.kind = Command::Kind::OPEN;
+    cmd.path = seg.path;
+    cmd.first_seq = next_seq_;
+
+    segment_bytes_ = sizeof(SegmentHeader);
+    last_index_at_ = 0;
+    segments_.push_back(std::move(seg));
+
+    // 保留策略: 超出段数上限时删除本 session 最旧的段
+    if (opts_.max_segments > 0 && segments_.size() > opts_.max_segments) {
+        Command unlink;
+        unlink.kind = Command::Kind::UNLINK;
+        unlink.path = std::move(segments_.front().path);
+        segments_.erase(segments_.begin());
+        submit(std::move(unlink));
+    }
+    return cmd;
+}
+
+void EpisodeLog::closeSegment() {
+    flush();
+    Command cmd;
+    cmd.kind = Command::Kind::CLOSE;
+    submit(std::move(cmd));
+}
+
+void EpisodeLog::submit(Command&& cmd) {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        queue_.push_back(std::move(cmd));
+    }
+    cv_.notify_one();
+}
+
+void EpisodeLog::flush() {
+    if (!open_ || buffer_.empty()) return;
+
+    std::vector<uint8_t> next;
+    bool dropped = false;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (queue_.size() >= MAX_PENDING_BUFFERS) {
+            dropped = true;
+        } else {
+            if (!spare_buffers_.empty()) {
+                next = std::move(spare_buffers_.back());
+                spare_buffers_.pop_back();
+            }
+            submitted_ += buffer_.size();
+            Command cmd;
+            cmd.kind = Command::Kind::WRITE;
+            cmd.bytes = std::move(buffer_);
+            queue_.push_back(std::move(cmd));
+        }
+    }
+
+    if (dropped) {
+        // 写线程跟不上: 丢掉这一块，回滚它在当前段里占的偏移和索引点 (缓冲只含当前段的记录)
+        size_t start = segment_bytes_ - buffer_.size();
+        Segment& seg = segments_.back();
+        while (!seg.index.empty() && seg.index.back().offset >= start) seg.index.pop_back();
+        last_index_at_ = seg.index.empty() ? 0 : seg.index.back().offset;
+        segment_bytes_ = start;
+        buffer_.clear();
+        if (dropped_buffers_++ == 0) {
+            titan::core::AsyncLogger::instance().log("[EpisodeLog] Writer backlogged, dropping buffered events");
+        }
+        return;
+    }
+
+    cv_.notify_one();
+    buffer_ = std::move(next);
+    buffer_.clear();
+    buffer_.reserve(opts_.buffer_bytes + 1024);
+}
+
+bool EpisodeLog::runCommand(Command& cmd) {
+    switch (cmd.kind) {
+        case Command::Kind::OPEN: {
+            fd_ = ::open(cmd.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd_ < 0) {
+                std::cerr << "[EpisodeLog] Cannot open " << cmd.path << ": " << std::strerror(errno) << std::endl;
+                return false;
+            }
+            SegmentHeader h{};
+            std::memcpy(h.magic, SEGMENT_MAGIC, sizeof(h.magic));
+            h.version = SEGMENT_VERSION;
+            h.header_bytes = sizeof(SegmentHeader);
+            h.wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            h.steady_ns = toNs(std::chrono::steady_clock::now());
+            h.first_seq = cmd.first_seq;
+            writeAll(fd_, &h, sizeof(h));
+            return true;
+        }
+        case Command::Kind::WRITE:
+            if (fd_ < 0) return false;   // 段没打开成功: 这一段的记录丢弃
+            writeAll(fd_, cmd.bytes.data(), cmd.bytes.size());
+            return true;
+        case Command::Kind::CLOSE:
+            if (fd_ < 0) return false;
+            ::fsync(fd_);
+            ::close(fd_);
+            fd_ = -1;
+            return true;
+        case Command::Kind::UNLINK:
+            return ::unlink(cmd.path.c_str()) == 0;
+    }
+    return false;
+}
+
+void EpisodeLog::writerLoop() {
+    while (true) {
+        Command cmd;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            cv_.wait(lock, [this] { return !queue_.empty() || !running_; });
+            if (queue_.empty()) break;   // 停止且命令已执行完
+            cmd = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        runCommand(cmd);
+        if (cmd.kind != Command::Kind::WRITE) continue;
+
+        uint64_t n = cmd.bytes.size();
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (spare_buffers_.size() < 4) {
+                cmd.bytes.clear();
+                spare_buffers_.push_back(std::move(cmd.bytes));
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(progress_->mtx);
+            progress_->written += n;   // 写失败也推进，回放方不会一直等
+        }
+        progress_->cv.notify_all();
+    }
+    {
+        std::lock_guard<std::mutex> lock(progress_->mtx);
+        progress_->stopped = true;
+    }
+    progress_->cv.notify_all();
+}
+
+void EpisodeLog::append(titan::core::EventType type, titan::core::TimePoint t,
+                        std::string_view prefix, std::string_view text,
+                        const uint8_t* detail, size_t detail_len) {
+    if (!open_) return;
+
+    RecordHeader h{};
+    h.marker = RECORD_MARKER;
+    h.type = static_cast<uint8_t>(type);
+    h.text_len = static_cast<uint32_t>(prefix.size() + text.size());
+    h.detail_len = static_cast<uint32_t>(detail_len);
+    h.steady_ns = toNs(t);
+    h.seq = next_seq_++;
+    size_t rec_size = sizeof(h) + h.text_len + h.detail_len;
+
+    // 滚动: 当前段放不下且不是空段
+    if (segment_bytes_ + rec_size > opts_.max_segment_bytes && segment_bytes_ > sizeof(SegmentHeader)) {
+        closeSegment();
+        submit(openSegment());
+    }
+
+    Segment& seg = segments_.back();
+    if (seg.index.empty()) seg.first_ns = h.steady_ns;
+    seg.last_ns = h.steady_ns;
+
+    // 稀疏时间索引
+    if (seg.index.empty() || segment_bytes_ - last_index_at_ >= opts_.index_stride_bytes) {
+        seg.index.push_back({h.steady_ns, segment_bytes_});
+        last_index_at_ = segment_bytes_;
+    }
+
+    const uint8_t* hp = reinterpret_cast<const uint8_t*>(&h);
+    buffer_.insert(buffer_.end(), hp, hp + sizeof(h));
+    buffer_.insert(buffer_.end(), prefix.begin(), prefix.end());
+    buffer_.insert(buffer_.end(), text.begin(), text.end());
+    if (detail_len > 0) buffer_.insert(buffer_.end(), detail, detail + detail_len);
+    segment_bytes_ += rec_size;
+
+    if (buffer_.size() >= opts_.buffer_bytes) flush();
+}
+
+EpisodeLog::Range EpisodeLog::range(titan::core::TimePoint from, titan::core::TimePoint to) {
+    flush();
+    Range r;
+    r.from_ns = toNs(from);
+    r.to_ns = toNs(to);
+    r.progress = progress_;
+    r.fence = submitted_;
+
+    for (size_t i = 0; i < segments_.size(); ++i) {
+        const auto& seg = segments_[i];
+        if (seg.index.empty() || seg.last_ns < r.from_ns || seg.first_ns > r.to_ns) continue;
+
+        // 稀疏索引定位: 最后一个 <= from 的索引点
+        auto it = std::upper_bound(seg.index.begin(), seg.index.end(), r.from_ns,
+            [](int64_t t, const IndexEntry& e) { return t < e.steady_ns; });
+        uint64_t begin = it == seg.index.begin() ? sizeof(SegmentHeader) : std::prev(it)->offset;
+        // 当前段缓冲已经交出，segment_bytes_ 就是栅栏处的长度；已关闭的段读到文件末尾
+        uint64_t end = i + 1 == segments_.size() ? segment_bytes_ : UINT64_MAX;
+        r.parts.push_back({seg.path, begin, end});
+    }
+    return r;
+}
+
+size_t EpisodeLog::replayRange(const Range& range, const std::function<void(const LoggedEvent&)>& fn) {
+    if (range.progress) {
+        std::unique_lock<std::mutex> lock(range.progress->mtx);
+        range.progress->cv.wait(lock, [&range] {
+            return range.progress->written >= range.fence || range.progress->stopped;
+        });
+    }
+    size_t count = 0;
+    for (const auto& part : range.parts) {
+        titan::core::MappedFile mf;
+        if (!mf.open(part.path)) continue;
+        size_t size = static_cast<size_t>(std::min<uint64_t>(mf.size(), part.end));
+        count += scanRecords(mf.data(), size, part.begin, range.from_ns, range.to_ns, fn);
+    }
+    return count;
+}
+
+size_t EpisodeLog::replay(titan::core::TimePoint from, titan::core::TimePoint to,
+                          const std::function<void(const LoggedEvent&)>& fn) {
+    return replayRange(range(from, to), fn);
+}
+
+size_t EpisodeLog::replayFile(const std::string& path, const std::function<void(const LoggedEvent&)>& fn) {
+    titan::core::MappedFile mf;
+    if (!mf.open(path) || mf.size() < sizeof(SegmentHeader)) return 0;
+
+    SegmentHeader h;
+    std::memcpy(&h, mf.data(), sizeof(h));
+    if (std::memcmp(h.magic, SEGMENT_MAGIC, sizeof(h.magic)) != 0 || h.version != SEGMENT_VERSION) {
+        std::cerr << "[EpisodeLog] Not a segment file: " << path << std::endl;
+        return 0;
+    }
+    return scanRecords(mf.data(), mf.size(), h.header_bytes, INT64_MIN, INT64_MAX, fn);
+}
+
+} // namespace titan::memory
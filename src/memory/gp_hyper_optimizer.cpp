@@ -0,0 +1,240 @@
+#include "titan/memory/gp_hyper_optimizer.h"
+#include "titan/core/async_logger.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <sstream>
+
+namespace titan::memory {
+
+using namespace Eigen;
+
+namespace {
+
+// 对数参数的取值范围 (防止优化跑到退化解)
+constexpr double MIN_LOG_LEN = -4.6;     // ℓ ≥ 0.01
+constexpr double MAX_LOG_LEN = 6.9;      // ℓ ≤ 1000
+constexpr double MIN_LOG_SIGNAL = -9.2;  // σf² ≥ 1e-4
+constexpr double MAX_LOG_SIGNAL = 9.2;
+constexpr double MIN_LOG_NOISE = -13.8;  // σn² ≥ 1e-6
+constexpr double MAX_LOG_NOISE = 2.3;    // σn² ≤ 10
+
+// θ = [log ℓ (1 或 d 维), log σf², log σn²]
+VectorXd toTheta(const GPHyperParams& p, bool ard) {
+    const Index nl = ard ? p.len_scales.size() : 1;
+    VectorXd theta(nl + 2);
+    if (ard) theta.head(nl) = p.len_scales.array().log().matrix();
+    else theta(0) = std::log(p.len_scales.mean());
+    theta(nl) = std::log(p.signal_var);
+    theta(nl + 1) = std::log(p.noise_var);
+    return theta;
+}
+
+GPHyperParams fromTheta(const VectorXd& theta, Index dim, bool ard) {
+    const Index nl = theta.size() - 2;
+    GPHyperParams p;
+    p.len_scales = ard ? VectorXd(theta.head(nl).array().exp().matrix()) : VectorXd::Constant(dim, std::exp(theta(0)));
+    p.signal_var = std::exp(theta(nl));
+    p.noise_var = std::exp(theta(nl + 1));
+    return p;
+}
+
+void clampTheta(VectorXd& theta) {
+    const Index nl = theta.size() - 2;
+    theta.head(nl) = theta.head(nl).cwiseMax(MIN_LOG_LEN).cwiseMin(MAX_LOG_LEN);
+    theta(nl) = std::clamp(theta(nl), MIN_LOG_SIGNAL, MAX_LOG_SIGNAL);
+    theta(nl + 1) = std::clamp(theta(nl + 1), MIN_LOG_NOISE, MAX_LOG_NOISE);
+}
+
+// 无噪声核矩阵 K_f (与 SparseGPMemory::kernelBlock 同一定义)
+MatrixXd kernelMatrix(const MatrixXd& X, const GPHyperParams& p) {
+    VectorXd w = p.len_scales.array().square().inverse().matrix();
+    MatrixXd WX = w.asDiagonal() * X;
+    VectorXd sq = (X.array() * WX.array()).colwise().sum().transpose();
+    MatrixXd d2 = -2.0 * X.transpose() * WX;
+    d2.colwise() += sq;
+    d2.rowwise() += sq.transpose();
+    return p.signal_var * (d2.cwiseMax(0.0) * -0.5).array().exp().matrix();
+}
+
+} // namespace
+
+double GPHyperOptimizer::logMarginalLikelihood(const MatrixXd& X, const VectorXd& y, const GPHyperParams& params,
+                                               bool ard, VectorXd* grad) {
+    const Index n = X.cols();
+    const Index d = X.rows();
+    MatrixXd Kf = kernelMatrix(X, params);
+    MatrixXd Ky = Kf;
+    Ky.diagonal().array() += params.noise_var;
+
+    LLT<MatrixXd> llt(Ky);
+    if (llt.info() != Success) return -std::numeric_limits<double>::infinity();
+    VectorXd alpha = llt.solve(y);
+    const MatrixXd& L = llt.matrixLLT();
+    double lml = -0.5 * y.dot(alpha) - L.diagonal().array().log().sum() - 0.5 * n * std::log(2.0 * M_PI);
+
+    if (grad) {
+        // A = ααᵀ - K⁻¹；M = A ∘ K_f
+        MatrixXd A = llt.solve(MatrixXd::Identity(n, n));
+        A = alpha * alpha.transpose() - A;
+        MatrixXd M = A.cwiseProduct(Kf);
+
+        const Index nl = ard ? d : 1;
+        grad->resize(nl + 2);
+
+        // ∂K_f,ij/∂log ℓ_k = K_f,ij (x_ik - x_jk)² / ℓ_k²
+        // Σ_ij M_ij (x_ik - x_jk)² = 2 Σ_i x_ik² (M1)_i - 2 x_kᵀ M x_k   (M 对称)
+        VectorXd row_sum = M.rowwise().sum();
+        MatrixXd XM = X * M;
+        VectorXd per_dim(d);
+        for (Index k = 0; k < d; ++k) {
+            double s = 2.0 * X.row(k).array().square().matrix().dot(row_sum) - 2.0 * XM.row(k).dot(X.row(k));
+            per_dim(k) = 0.5 * s / (params.len_scales(k) * params.len_scales(k));
+        }
+        if (ard) grad->head(d) = per_dim;
+        else (*grad)(0) = per_dim.sum();
+
+        (*grad)(nl) = 0.5 * M.sum();                               // log σf²
+        (*grad)(nl + 1) = 0.5 * params.noise_var * A.trace();      // log σn²
+    }
+    return lml;
+}
+
+GPHyperOptimizer::GPHyperOptimizer(const Options& opts) : opts_(opts) {
+    worker_ = std::thread(&GPHyperOptimizer::workerLoop, this);
+}
+
+GPHyperOptimizer::~GPHyperOptimizer() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        running_ = false;
+    }
+    cv_.notify_one();
+    if (worker_.joinable()) worker_.join();
+    delete result_.exchange(nullptr, std::memory_order_acq_rel);
+}
+
+void GPHyperOptimizer::submit(const SparseGPMemory& gp) {
+    if (gp.size() < opts_.min_points) return;
+    auto job = std::make_unique<Job>();
+    job->X = gp.features();
+    job->y = gp.outcomes();
+    job->init = gp.hyperParams();
+    job->data_version = gp.dataVersion();
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        pending_ = std::move(job);
+    }
+    cv_.notify_one();
+}
+
+bool GPHyperOptimizer::busy() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return working_ || pending_ != nullptr;
+}
+
+std::unique_ptr<GPHyperUpdate> GPHyperOptimizer::take() {
+    return std::unique_ptr<GPHyperUpdate>(result_.exchange(nullptr, std::memory_order_acq_rel));
+}
+
+void GPHyperOptimizer::workerLoop() {
+    while (true) {
+        std::unique_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            cv_.wait(lock, [this] { return pending_ != nullptr || !running_; });
+            if (!running_) break;
+            job = std::move(pending_);
+            working_ = true;
+        }
+
+        auto update = optimize(*job);
+        if (update) {
+            // 旧结果没被取走就直接作废
+            delete result_.exchange(update.release(), std::memory_order_acq_rel);
+        }
+
+        std::lock_guard<std::mutex> lock(mtx_);
+        working_ = false;
+    }
+}
+
+std::unique_ptr<GPHyperUpdate> GPHyperOptimizer::optimize(const Job& job) const {
+    const Index n = job.X.cols();
+    const Index d = job.X.rows();
+    if (job.init.len_scales.size() != d) return nullptr;
+
+    // 1. 数据太多时随机抽样 (只影响优化阶段，最终分解用全部数据)
+    MatrixXd X = job.X;
+    VectorXd y = job.y;
+    if (static_cast<size_t>(n) > opts_.max_points) {
+        std::vector<Index> idx(static_cast<size_t>(n));
+        std::iota(idx.begin(), idx.end(), 0);
+        std::mt19937 rng(static_cast<uint32_t>(job.data_version));
+        std::shuffle(idx.begin(), idx.end(), rng);
+        const Index m = static_cast<Index>(opts_.max_points);
+        X.resize(d, m);
+        y.resize(m);
+        for (Index i = 0; i < m; ++i) {
+            X.col(i) = job.X.col(idx[static_cast<size_t>(i)]);
+            y(i) = job.y(idx[static_cast<size_t>(i)]);
+        }
+    }
+
+    // 2. Adam (梯度上升)
+    VectorXd theta = toTheta(job.init, opts_.ard);
+    clampTheta(theta);
+    VectorXd grad, m1 = VectorXd::Zero(theta.size()), m2 = VectorXd::Zero(theta.size());
+    const double beta1 = 0.9, beta2 = 0.999, eps = 1e-8;
+
+    const double initial_lml = logMarginalLikelihood(X, y, fromTheta(theta, d, opts_.ard), opts_.ard, nullptr);
+    VectorXd best_theta = theta;
+    double best_lml = initial_lml;
+
+    for (int it = 1; it <= opts_.max_iters; ++it) {
+        double lml = logMarginalLikelihood(X, y, fromTheta(theta, d, opts_.ard), opts_.ard, &grad);
+        if (!std::isfinite(lml)) break;
+        if (lml > best_lml) {
+            best_lml = lml;
+            best_theta = theta;
+        }
+        m1 = beta1 * m1 + (1.0 - beta1) * grad;
+        m2 = beta2 * m2 + (1.0 - beta2) * grad.cwiseAbs2();
+        VectorXd m1_hat = m1 / (1.0 - std::pow(beta1, it));
+        VectorXd m2_hat = m2 / (1.0 - std::pow(beta2, it));
+        theta += (opts_.step * m1_hat.array() / (m2_hat.array().sqrt() + eps)).matrix();
+        clampTheta(theta);
+    }
+    double final_lml = logMarginalLikelihood(X, y, fromTheta(theta, d, opts_.ard), opts_.ard, nullptr);
+    if (final_lml > best_lml) {
+        best_lml = final_lml;
+        best_theta = theta;
+    }
+    if (!(best_lml > initial_lml)) return nullptr;   // 没有改进就不打扰学习线程
+
+    // 3. 用新超参数在全部数据上分解
+    auto update = std::make_unique<GPHyperUpdate>();
+    update->params = fromTheta(best_theta, d, opts_.ard);
+    update->data_version = job.data_version;
+    update->log_likelihood = best_lml;
+
+    MatrixXd K = kernelMatrix(job.X, update->params);
+    K.diagonal().array() += update->params.noise_var;
+    LLT<MatrixXd> llt(K);
+    if (llt.info() != Success) return nullptr;
+    update->L = llt.matrixL();
+    update->alpha = llt.solve(job.y);
+    MatrixXd L_inv = update->L.triangularView<Lower>().solve(MatrixXd::Identity(n, n));
+    update->q_diag = L_inv.colwise().squaredNorm().transpose();
+
+    std::ostringstream ss;
+    ss << "[GP] Hyperparameters updated: lml " << initial_lml << " -> " << best_lml
+       << ", signal " << update->params.signal_var << ", noise " << update->params.noise_var
+       << ", len [" << update->params.len_scales.transpose() << "]";
+    titan::core::AsyncLogger::instance().log(ss.str());
+    return update;
+}
+
+} // namespace titan::memory
@@ -1,59 +1,436 @@
 #include "titan/memory/sparse_gp_memory.h"
+#include "titan/core/mapped_file.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
 #include <iostream>
 #include <cmath>
+#include <fcntl.h>
+#include <unistd.h>
 
 namespace titan::memory {
 
 using namespace Eigen;
 
-SparseGPMemory::SparseGPMemory() 
-    : dirty_(true), len_scale_(1.0), noise_var_(0.1), signal_var_(1.0) {}
+namespace {
 
-double SparseGPMemory::kernel(const VectorXd& x1, const VectorXd& x2) {
-    return signal_var_ * std::exp(-0.5 * (x1 - x2).squaredNorm() / (len_scale_ * len_scale_));
+// 对角元下限: 重复 / 几乎重复的点会让新对角元趋近 0 (噪声项正常情况下保证它 ≥ σ)
+constexpr double MIN_PIVOT = 1e-9;
+
+// --- 持久化格式 ---
+// [GPHeader][len_scales: d][X: d×n][x_sq: n][y: n][score: n][alpha: n][q_diag: n][L: 按列压缩的下三角, n(n+1)/2]
+// 全部为 double，按列主序；checksum 覆盖 header 之后的全部数据
+// v1: 没有 len_scales 段，所有维度共用 header 中的 len_scale
+constexpr char GP_MAGIC[8] = {'T', 'I', 'T', 'A', 'N', 'G', 'P', '\0'};
+constexpr uint32_t GP_VERSION = 2;
+
+#pragma pack(push, 1)
+struct GPHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_bytes;
+    uint64_t dim;
+    uint64_t n;
+    uint64_t max_nodes;
+    double len_scale;     // v1 的各向同性长度尺度；v2 起为 len_scales 的均值 (仅供查看)
+    double noise_var;
+    double signal_var;
+    uint64_t payload_bytes;
+    uint64_t checksum;
+};
+#pragma pack(pop)
+
+// 按 8 字节字做 FNV-1a (payload 是 double 数组，长度总是 8 的倍数)
+uint64_t checksumWords(const uint8_t* p, size_t bytes) {
+    uint64_t h = 1469598103934665603ull;
+    for (size_t i = 0; i + 8 <= bytes; i += 8) {
+        uint64_t w;
+        std::memcpy(&w, p + i, 8);
+        h ^= w;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+bool writeAll(int fd, const void* data, size_t len) {
+    const char* p = static_cast<const char*>(data);
+    while (len > 0) {
+        ssize_t n = ::write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+} // namespace
+
+SparseGPMemory::SparseGPMemory(size_t max_nodes)
+    : max_nodes_(std::max<size_t>(1, max_nodes)) {
+    const Index cap = static_cast<Index>(max_nodes_ + 1);
+    L_.setZero(cap, cap);
+    x_sq_.setZero(cap);
+    y_.setZero(cap);
+    score_.setZero(cap);
+    q_diag_.setZero(cap);
+}
+
+template <typename DerivedA, typename DerivedB>
+MatrixXd SparseGPMemory::kernelBlock(const MatrixBase<DerivedA>& A, const VectorXd& a_sq,
+                                     const MatrixBase<DerivedB>& B, const VectorXd& b_sq) const {
+    // 展开式可能因舍入出现很小的负距离，截断到 0
+    MatrixXd d2 = (-2.0 * A.transpose() * (w_.asDiagonal() * B)).eval();
+    d2.colwise() += a_sq;
+    d2.rowwise() += b_sq.transpose();
+    return hyper_.signal_var * (d2.cwiseMax(0.0) * -0.5).array().exp().matrix();
+}
+
+void SparseGPMemory::setHyperParams(const GPHyperParams& params) {
+    hyper_ = params;
+    w_ = hyper_.len_scales.array().square().inverse().matrix();
+    if (n_ > 0) x_sq_.head(n_) = (X_.leftCols(n_).array().square().colwise() * w_.array()).colwise().sum().transpose();
 }
 
-void SparseGPMemory::recompute() {
-    if (!dirty_ || nodes_.empty()) return;
-    int n = nodes_.size();
-    MatrixXd K(n, n);
-    for(int i=0; i<n; ++i)
-        for(int j=0; j<n; ++j)
-            K(i,j) = kernel(nodes_[i].features, nodes_[j].features);
-    
-    K += noise_var_ * MatrixXd::Identity(n, n);
-    K_inv_ = K.llt().solve(MatrixXd::Identity(n, n));
-    dirty_ = false;
+// alpha = L⁻ᵀ L⁻¹ y
+void SparseGPMemory::updateAlpha() {
+    alpha_ = y_.head(n_);
+    if (n_ == 0) return;
+    auto L = L_.topLeftCorner(n_, n_).triangularView<Lower>();
+    L.solveInPlace(alpha_);
+    L.transpose().solveInPlace(alpha_);
 }
 
-std::pair<double, double> SparseGPMemory::predict(const VectorXd& x) {
-    if (nodes_.empty()) return {0.0, 100.0};
-    recompute();
-    // ... (与之前代码一致的实现) ...
-    // 此处省略具体逻辑以节省篇幅，实际需填入之前讨论的代码
-    return {0.0, 0.0}; // Placeholder
+void SparseGPMemory::rebuildFactor() {
+    updates_since_rebuild_ = 0;
+    if (n_ == 0) {
+        alpha_.resize(0);
+        return;
+    }
+    auto X = X_.leftCols(n_);
+    VectorXd sq = x_sq_.head(n_);
+    MatrixXd K = kernelBlock(X, sq, X, sq);
+    K.diagonal().array() += hyper_.noise_var;
+    LLT<MatrixXd> llt(K);
+    L_.topLeftCorner(n_, n_) = llt.matrixL();
+
+    // diag(K⁻¹) = L⁻¹ 各列的平方范数
+    MatrixXd L_inv = L_.topLeftCorner(n_, n_).triangularView<Lower>().solve(MatrixXd::Identity(n_, n_));
+    q_diag_.head(n_) = L_inv.colwise().squaredNorm().transpose();
+    updateAlpha();
+}
+
+// 追加节点: [L 0; l12ᵀ l22]，其中 L l12 = k，l22 = sqrt(k_nn + σ² - ||l12||²)
+void SparseGPMemory::appendNode(const VectorXd& x, double y, double score) {
+    const Index n = n_;
+    if (n == 0) {
+        dim_ = x.size();
+        X_.setZero(dim_, static_cast<Index>(max_nodes_ + 1));
+        if (hyper_.len_scales.size() != dim_) {
+            GPHyperParams params = hyper_;
+            params.len_scales = VectorXd::Ones(dim_);   // 初始长度尺度 1.0
+            setHyperParams(params);
+        }
+    }
+    if (X_.cols() < n + 1) {
+        X_.conservativeResize(NoChange, n + 1);
+        x_sq_.conservativeResize(n + 1);
+        y_.conservativeResize(n + 1);
+        score_.conservativeResize(n + 1);
+        q_diag_.conservativeResize(n + 1);
+    }
+    if (L_.rows() < n + 1) L_.conservativeResize(n + 1, n + 1);
+
+    double sq = x.cwiseAbs2().dot(w_);
+    VectorXd k = kernelBlock(X_.leftCols(n), x_sq_.head(n), x, VectorXd::Constant(1, sq));
+    if (n > 0) L_.topLeftCorner(n, n).triangularView<Lower>().solveInPlace(k);
+
+    double d2 = hyper_.signal_var + hyper_.noise_var - k.squaredNorm();
+    L_.row(n).head(n) = k.transpose();
+    const double l22 = std::sqrt(std::max(d2, MIN_PIVOT));
+    L_(n, n) = l22;
+
+    // 新的 L⁻¹ 末行为 [-(L⁻ᵀ l12)ᵀ / l22, 1 / l22]，各列平方范数相应增加
+    if (n > 0) {
+        L_.topLeftCorner(n, n).triangularView<Lower>().transpose().solveInPlace(k);
+        q_diag_.head(n).array() += (k.array() / l22).square();
+    }
+    q_diag_(n) = 1.0 / (l22 * l22);
+
+    X_.col(n) = x;
+    x_sq_(n) = sq;
+    y_(n) = y;
+    score_(n) = score;
+    ++n_;
+    ++data_version_;
+    updateAlpha();
 }
 
-// ... 其他函数的具体实现 ...
+// 删除第 idx 个节点:
+//   L = [L11 0 0; l21ᵀ l22 0; L31 l32 L33]  ->  [L11 0; L31 L33']，L33' L33'ᵀ = L33 L33ᵀ + l32 l32ᵀ
+void SparseGPMemory::removeNode(Index idx) {
+    const Index n = n_;
+    const Index i = idx;
+    const Index m = n - i - 1;   // idx 之后的节点数
+
+    // diag(K⁻¹) 的更新: 删除后的逆是原逆的 Schur 补，Q'_jj = Q_jj - Q_ji² / Q_ii
+    // Q 的第 i 列 = L⁻ᵀ L⁻¹ e_i (L⁻¹ e_i 的前 i 项为 0)
+    VectorXd qi = VectorXd::Zero(n);
+    qi(i) = 1.0;
+    L_.block(i, i, n - i, n - i).triangularView<Lower>().solveInPlace(qi.tail(n - i));
+    L_.topLeftCorner(n, n).triangularView<Lower>().transpose().solveInPlace(qi);
+    q_diag_.head(n).array() -= qi.array().square() / qi(i);
+
+    if (m > 0) {
+        // rank-one 更新 L33 (逐列 Givens 形式)
+        VectorXd x = L_.col(i).segment(i + 1, m);
+        for (Index c = 0; c < m; ++c) {
+            const Index kk = i + 1 + c;
+            double lkk = L_(kk, kk);
+            double r = std::hypot(lkk, x(c));
+            double cs = r / lkk;
+            double sn = x(c) / lkk;
+            L_(kk, kk) = r;
+            for (Index rr = c + 1; rr < m; ++rr) {
+                const Index row = i + 1 + rr;
+                L_(row, kk) = (L_(row, kk) + sn * x(rr)) / cs;
+                x(rr) = cs * x(rr) - sn * L_(row, kk);
+            }
+        }
+        // 删除第 i 行与第 i 列 (上三角部分不使用，整体平移即可)
+        L_.block(i, 0, m, n) = L_.block(i + 1, 0, m, n).eval();
+        L_.block(0, i, n - 1, m) = L_.block(0, i + 1, n - 1, m).eval();
+
+        // 支撑点数据同样左移一列
+        X_.middleCols(i, m) = X_.middleCols(i + 1, m).eval();
+        x_sq_.segment(i, m) = x_sq_.segment(i + 1, m).eval();
+        y_.segment(i, m) = y_.segment(i + 1, m).eval();
+        score_.segment(i, m) = score_.segment(i + 1, m).eval();
+        q_diag_.segment(i, m) = q_diag_.segment(i + 1, m).eval();
+    }
+
+    --n_;
+    ++data_version_;
+    updateAlpha();
+}
+
+std::pair<double, double> SparseGPMemory::predict(const VectorXd& x) const {
+    if (n_ == 0 || x.size() != dim_) return {0.0, 100.0};
+
+    VectorXd k = kernelBlock(X_.leftCols(n_), x_sq_.head(n_), x, VectorXd::Constant(1, x.cwiseAbs2().dot(w_)));
+    double mean = k.dot(alpha_);
+    L_.topLeftCorner(n_, n_).triangularView<Lower>().solveInPlace(k);
+    double variance = std::max(0.0, hyper_.signal_var - k.squaredNorm());
+    return {mean, variance};
+}
+
+std::unique_ptr<const GPPredictor> SparseGPMemory::predictor() const {
+    auto p = std::make_unique<GPPredictor>();
+    p->X_ = X_.leftCols(n_);
+    p->x_sq_ = x_sq_.head(n_);
+    p->alpha_ = alpha_.head(n_);
+    p->L_ = L_.topLeftCorner(n_, n_).triangularView<Lower>();
+    p->w_ = w_;
+    p->signal_var_ = hyper_.signal_var;
+    return p;
+}
+
+// 与 SparseGPMemory::kernelBlock 相同的展开式，单列版本；全部写在工作区里
+std::pair<double, double> GPPredictor::predict(const VectorXd& x, Workspace& ws) const {
+    const Index n = alpha_.size();
+    if (n == 0 || x.size() != X_.rows()) return {0.0, 100.0};
+
+    ws.reserve(static_cast<size_t>(n), static_cast<size_t>(x.size()));
+    auto wx = ws.wx.head(x.size());
+    auto k = ws.k.head(n);
+    wx.noalias() = w_.cwiseProduct(x);
+    k.noalias() = X_.transpose() * wx;
+    const double x_sq = x.dot(wx);
+    k.array() = signal_var_ * ((k.array() * -2.0 + x_sq_.array() + x_sq).cwiseMax(0.0) * -0.5).exp();
+
+    double mean = k.dot(alpha_);
+    L_.triangularView<Lower>().solveInPlace(k);
+    double variance = std::max(0.0, signal_var_ - k.squaredNorm());
+    return {mean, variance};
+}
+
+// 批量版本: 查询按列分块，每块的核矩阵一次 GEMM 得到；
+// 方差部分先显式求一次 L⁻¹ (n³/3，与查询数无关)，之后每块是稠密 GEMM，比多右端 TRSM 快得多
+std::pair<VectorXd, VectorXd> SparseGPMemory::predictBatch(const MatrixXd& queries) const {
+    constexpr Index BLOCK = 256;   // 每块查询数 (n×BLOCK 的核块留在缓存里)
+    const Index m = queries.cols();
+    if (n_ == 0 || queries.rows() != dim_) {
+        return {VectorXd::Zero(m), VectorXd::Constant(m, 100.0)};
+    }
+
+    const auto X = X_.leftCols(n_);
+    const VectorXd x_sq = x_sq_.head(n_);
+    MatrixXd L_inv = L_.topLeftCorner(n_, n_).triangularView<Lower>().solve(MatrixXd::Identity(n_, n_));
+
+    VectorXd mean(m), variance(m);
+    MatrixXd V;
+    for (Index start = 0; start < m; start += BLOCK) {
+        const Index cols = std::min(BLOCK, m - start);
+        auto Q = queries.middleCols(start, cols);
+        VectorXd q_sq = (Q.array().square().colwise() * w_.array()).colwise().sum().transpose();
+        MatrixXd Ks = kernelBlock(X, x_sq, Q, q_sq);
+        mean.segment(start, cols).noalias() = Ks.transpose() * alpha_;
+        V.noalias() = L_inv * Ks;
+        variance.segment(start, cols) =
+            (hyper_.signal_var - V.colwise().squaredNorm().transpose().array()).cwiseMax(0.0).matrix();
+    }
+    return {std::move(mean), std::move(variance)};
+}
 
 void SparseGPMemory::learn(const VectorXd& x, double y, double surprise) {
-     // 实现剪枝和添加逻辑
-     if (nodes_.size() >= MAX_NODES && surprise < 0.2) return;
-     if (nodes_.size() >= MAX_NODES) pruneRedundant(x);
-     nodes_.push_back({x, y, surprise});
-     dirty_ = true;
+     if (n_ > 0 && x.size() != dim_) {
+         std::cerr << "[GP] Feature dimension mismatch: " << x.size() << " vs " << dim_ << std::endl;
+         return;
+     }
+     // 先加入 (预留了 max_nodes + 1 个槽位)，超出预算再换出信息量最低的节点
+     appendNode(x, y, surprise);
+     if (static_cast<size_t>(n_) > max_nodes_) pruneLeastInformative();
+
+     // 增量更新累积的舍入误差定期清零 (摊还后仍是每次 O(n²))
+     if (++updates_since_rebuild_ >= max_nodes_) rebuildFactor();
 }
 
-void SparseGPMemory::pruneRedundant(const VectorXd& x_new) {
-    // 实现剪枝逻辑
+// Csató-Opper 得分: 删除节点 i 引起的后验均值变化 ∝ alpha_i² / [(K + σ²I)⁻¹]_ii
+void SparseGPMemory::pruneLeastInformative() {
+    if (n_ == 0) return;
+    Index victim;
+    (alpha_.array().square() / q_diag_.head(n_).array()).minCoeff(&victim);
+    removeNode(victim);
 }
 
-void SparseGPMemory::save(const std::string& path) {
-    // 实现保存逻辑
+void SparseGPMemory::applyHyperUpdate(const GPHyperUpdate& update) {
+    if (update.params.len_scales.size() != dim_) return;
+    setHyperParams(update.params);
+    if (update.data_version == data_version_ && update.L.rows() == n_ && update.alpha.size() == n_) {
+        L_.topLeftCorner(n_, n_) = update.L;
+        alpha_ = update.alpha;
+        q_diag_.head(n_) = update.q_diag;
+        updates_since_rebuild_ = 0;
+    } else {
+        rebuildFactor();   // 优化期间支撑点已经变化
+    }
 }
 
-void SparseGPMemory::load(const std::string& path) {
-    // 实现加载逻辑
+bool SparseGPMemory::save(const std::string& path) const {
+    const size_t n = static_cast<size_t>(n_);
+    const size_t d = static_cast<size_t>(dim_);
+    const size_t doubles = d + d * n + 5 * n + n * (n + 1) / 2;
+
+    std::vector<double> payload;
+    payload.reserve(doubles);
+    auto append = [&payload](const double* p, size_t count) { payload.insert(payload.end(), p, p + count); };
+    append(hyper_.len_scales.data(), d);
+    for (size_t c = 0; c < n; ++c) append(X_.col(static_cast<Index>(c)).data(), d);
+    append(x_sq_.data(), n);
+    append(y_.data(), n);
+    append(score_.data(), n);
+    append(alpha_.data(), n);
+    append(q_diag_.data(), n);
+    for (size_t c = 0; c < n; ++c) append(&L_(static_cast<Index>(c), static_cast<Index>(c)), n - c);
+
+    GPHeader h{};
+    std::memcpy(h.magic, GP_MAGIC, sizeof(h.magic));
+    h.version = GP_VERSION;
+    h.header_bytes = sizeof(GPHeader);
+    h.dim = d;
+    h.n = n;
+    h.max_nodes = max_nodes_;
+    h.len_scale = d > 0 ? hyper_.len_scales.mean() : 1.0;
+    h.noise_var = hyper_.noise_var;
+    h.signal_var = hyper_.signal_var;
+    h.payload_bytes = payload.size() * sizeof(double);
+    h.checksum = checksumWords(reinterpret_cast<const uint8_t*>(payload.data()), h.payload_bytes);
+
+    std::string tmp_path = path + ".tmp";
+    int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "[GP] Cannot open " << tmp_path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    bool ok = writeAll(fd, &h, sizeof(h)) && writeAll(fd, payload.data(), h.payload_bytes) && ::fsync(fd) == 0;
+    ::close(fd);
+    if (!ok || ::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "[GP] Save to " << path << " failed: " << std::strerror(errno) << std::endl;
+        ::unlink(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool SparseGPMemory::load(const std::string& path) {
+    titan::core::MappedFile file;
+    if (!file.open(path)) return false;   // 首次启动没有文件是正常情况
+
+    GPHeader h{};
+    if (file.size() < sizeof(h)) {
+        std::cerr << "[GP] " << path << " is truncated" << std::endl;
+        return false;
+    }
+    std::memcpy(&h, file.data(), sizeof(h));
+    if (std::memcmp(h.magic, GP_MAGIC, sizeof(h.magic)) != 0 || h.version < 1 || h.version > GP_VERSION ||
+        h.header_bytes < sizeof(h)) {
+        std::cerr << "[GP] " << path << " has unknown format/version" << std::endl;
+        return false;
+    }
+    const size_t n = h.n;
+    const size_t d = h.dim;
+    const size_t scale_doubles = h.version >= 2 ? d : 0;
+    const size_t doubles = scale_doubles + d * n + 5 * n + n * (n + 1) / 2;
+    if (h.payload_bytes != doubles * sizeof(double) || file.size() < h.header_bytes + h.payload_bytes) {
+        std::cerr << "[GP] " << path << " is truncated" << std::endl;
+        return false;
+    }
+    const uint8_t* payload = file.data() + h.header_bytes;
+    if (checksumWords(payload, h.payload_bytes) != h.checksum) {
+        std::cerr << "[GP] " << path << " checksum mismatch" << std::endl;
+        return false;
+    }
+
+    // 预算取构造参数与文件中节点数的较大者
+    max_nodes_ = std::max<size_t>(max_nodes_, n);
+    const Index cap = static_cast<Index>(max_nodes_ + 1);
+    n_ = static_cast<Index>(n);
+    dim_ = static_cast<Index>(d);
+    X_.setZero(dim_, cap);
+    L_.setZero(cap, cap);
+    x_sq_.setZero(cap);
+    y_.setZero(cap);
+    score_.setZero(cap);
+    q_diag_.setZero(cap);
+    alpha_.resize(n_);
+
+    // 矩阵缓冲的列跨度是 max_nodes + 1，不能直接引用映射区域，按列拷回
+    const uint8_t* p = payload;
+    auto take = [&p](double* dst, size_t count) {
+        if (count == 0) return;
+        std::memcpy(dst, p, count * sizeof(double));
+        p += count * sizeof(double);
+    };
+    GPHyperParams params;
+    params.noise_var = h.noise_var;
+    params.signal_var = h.signal_var;
+    params.len_scales = VectorXd::Constant(dim_, h.len_scale);
+    take(params.len_scales.data(), scale_doubles);
+    for (size_t c = 0; c < n; ++c) take(X_.col(static_cast<Index>(c)).data(), d);
+    take(x_sq_.data(), n);
+    take(y_.data(), n);
+    take(score_.data(), n);
+    take(alpha_.data(), n);
+    take(q_diag_.data(), n);
+    for (size_t c = 0; c < n; ++c) take(&L_(static_cast<Index>(c), static_cast<Index>(c)), n - c);
+    setHyperParams(params);   // 由特征重新算加权范数 (v1 文件存的是未加权范数)
+
+    updates_since_rebuild_ = 0;
+    ++data_version_;
+    std::cout << "[GP] Loaded " << n << " support points from " << path << std::endl;
+    return true;
 }
 
 } // namespace titan::memory
\ No newline at end of file